@@ -36,11 +36,25 @@ uint8_t adxl345_read_int_source(void)
 }
 
 
+// Raw axis counts (full resolution: 3.9 mg/LSB)
+
+void adxl345_read_raw(int16_t *x, int16_t *y, int16_t *z)
+{
+    uint8_t d[6];
+
+    for (uint8_t i = 0; i < 6; i++)
+        d[i] = i2c_read_reg(ADXL345_ADDR, DATAX0 + i);
+
+    *x = (int16_t)((d[1] << 8) | d[0]);
+    *y = (int16_t)((d[3] << 8) | d[2]);
+    *z = (int16_t)((d[5] << 8) | d[4]);
+}
+
 void adxl345_read_xyz(float *x, float *y, float *z)
 {
     int16_t rx, ry, rz;
 
-    adxl345_read_xyz(&rx, &ry, &rz);
+    adxl345_read_raw(&rx, &ry, &rz);
 
     *x = rx * 0.0039f;
     *y = ry * 0.0039f;
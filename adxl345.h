@@ -14,11 +14,13 @@
 #define INT_SOURCE      0x30
 #define POWER_CTL       0x2D
 #define DATA_FORMAT     0x31
+#define DATAX0          0x32
 //#define DATA_rate       0x2C
 
 void adxl345_init_activity(void);
 uint8_t adxl345_read_int_source(void);
 void adxl345_read_xyz(float *x, float *y, float *z);
+void adxl345_read_raw(int16_t *x, int16_t *y, int16_t *z);
 
 
 #endif
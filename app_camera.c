@@ -67,7 +67,7 @@ void App_Camera_StartTask(void)
 //     ESP_LOGI(TAG, "Capture request received");
 // }
 
-void App_Camera_CaptureOnce(void)
+void App_Camera_CaptureOnce(uint32_t event_id)
 {
     camera_fb_t *fb = esp_camera_fb_get();
     if (!fb) {
@@ -75,7 +75,7 @@ void App_Camera_CaptureOnce(void)
         return;
     }
 
-    WiFi_SendJPEG(fb->buf, fb->len);
+    WiFi_SendJPEG(fb->buf, fb->len, event_id);
 
     esp_camera_fb_return(fb);
     ESP_LOGI("CAM", "Image captured & sent");
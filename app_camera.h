@@ -18,5 +18,5 @@ extern QueueHandle_t g_frame_queue;
 void App_Camera_Init(void);
 void App_Camera_StartTask(void);
 
-/* Trigger one-shot capture (called from WiFi CMD task) */
-void App_Camera_CaptureOnce(void);
+/* Trigger one-shot capture for an event (called from WiFi CMD task) */
+void App_Camera_CaptureOnce(uint32_t event_id);
@@ -1,13 +1,18 @@
 #include "app_wifi_task.h"
 #include "wifi_hal.h"
 #include "app_camera.h"
+#include "image_proto.h"
+#include "image_fec.h"
 
 #include "lwip/sockets.h"
 #include "lwip/inet.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include <string.h>
+#include <stdlib.h>
 
 static const char *TAG = "APP_WIFI";
 
@@ -15,11 +20,37 @@ static const char *TAG = "APP_WIFI";
 #define EVENT_PORT  5000
 #define CMD_PORT    9100
 #define IMAGE_PORT   9200
-#define MAX_PAYLOAD  1400
+
+#define IMG_CACHE_FRAMES  4     /* frames kept for NACK retransmission */
+
+/* Reed-Solomon repair chunks: IMG_FEC_PERCENT overhead per block of
+   IMG_FEC_BLOCK data chunks, 0 = off (NACK retransmission only) */
+#define IMG_FEC_PERCENT   0
+#define IMG_FEC_BLOCK     16
 
 static int event_sock = -1;
 static struct sockaddr_in server_addr;
 
+/* one socket for every image, so the receiver's NACKs can reach us */
+static int img_sock = -1;
+static struct sockaddr_in img_addr;
+
+typedef struct {
+    uint16_t frame_id;
+    uint32_t event_id;
+    uint8_t *buf;           /* PSRAM copy: the camera fb is returned after send */
+    size_t   cap;
+    size_t   len;
+} img_cache_t;
+
+static img_cache_t       img_cache[IMG_CACHE_FRAMES];
+static SemaphoreHandle_t img_cache_lock;
+
+static image_gf_t        img_gf;
+static uint8_t          *img_parity;    /* m repair chunks of the current block */
+
+static void image_nack_task(void *arg);
+
 static void wifi_task(void *arg)
 {
     while (!WiFi_IsConnected()) {
@@ -34,6 +65,16 @@ static void wifi_task(void *arg)
 
     ESP_LOGI(TAG, "STEP-1: Ready to send events");
 
+    img_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (img_sock < 0) {
+        ESP_LOGE(TAG, "Image socket create failed");
+    } else {
+        img_addr.sin_family = AF_INET;
+        img_addr.sin_port = htons(IMAGE_PORT);
+        img_addr.sin_addr.s_addr = inet_addr(SERVER_IP);
+        xTaskCreate(image_nack_task, "img_nack", 4096, NULL, 5, NULL);
+    }
+
     vTaskDelete(NULL);
 }
 
@@ -58,8 +99,9 @@ static void command_rx_task(void *arg)
 
             ESP_LOGI(TAG, "RX CMD: %s", rx);
 
-            if (strcmp(rx, "CAPTURE:1") == 0) {
-                App_Camera_CaptureOnce();
+            // CAPTURE:<event id>; the ID is stamped on every chunk of the image
+            if (strncmp(rx, "CAPTURE:", 8) == 0) {
+                App_Camera_CaptureOnce((uint32_t)strtoul(rx + 8, NULL, 10));
             }
         }
     }
@@ -67,6 +109,8 @@ static void command_rx_task(void *arg)
 
 void App_WiFi_StartTask(void)
 {
+    img_cache_lock = xSemaphoreCreateMutex();
+    image_gf_init(&img_gf);
     xTaskCreate(wifi_task, "wifi_evt", 4096, NULL, 5, NULL);
     xTaskCreate(command_rx_task, "wifi_cmd", 4096, NULL, 5, NULL);
 }
@@ -85,55 +129,144 @@ void WiFi_SendEvent(const char *msg)
     ESP_LOGI(TAG, "EVENT sent → %s", msg);
 }
 
-typedef struct __attribute__((packed)) {
-    uint16_t frame_id;
-    uint16_t chunk_id;
-    uint16_t total_chunks;
-    uint16_t payload_size;
-} jpeg_hdr_t;
+static void send_chunk(const uint8_t *data, size_t len, uint16_t frame_id,
+                       uint16_t chunk_id, uint16_t total_chunks, uint32_t event_id)
+{
+    uint8_t packet[sizeof(jpeg_hdr_t) + IMAGE_MAX_PAYLOAD];
+
+    jpeg_hdr_t *hdr = (jpeg_hdr_t *)packet;
+    hdr->frame_id = frame_id;
+    hdr->chunk_id = chunk_id;
+    hdr->total_chunks = total_chunks;
+    hdr->event_id = event_id;
+
+    size_t offset = (size_t)chunk_id * IMAGE_MAX_PAYLOAD;
+    size_t chunk = (len - offset > IMAGE_MAX_PAYLOAD) ? IMAGE_MAX_PAYLOAD : (len - offset);
+    hdr->payload_size = chunk;
 
-void WiFi_SendJPEG(const uint8_t *data, size_t len)
+    memcpy(packet + sizeof(jpeg_hdr_t), data + offset, chunk);
+
+    sendto(img_sock,
+           packet,
+           sizeof(jpeg_hdr_t) + chunk,
+           0,
+           (struct sockaddr *)&img_addr,
+           sizeof(img_addr));
+}
+
+/* repair chunks for data chunks [first, first + k) of the frame */
+static void send_parity(const uint8_t *data, size_t len, uint16_t frame_id, uint16_t total_chunks,
+                        uint32_t event_id, unsigned block, unsigned first, unsigned k)
 {
-    static uint16_t frame_id = 0;
-    frame_id++;
+    unsigned m = image_fec_parity(IMG_FEC_BLOCK, IMG_FEC_PERCENT);
 
-    int img_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
-    if (img_sock < 0) {
-        ESP_LOGE(TAG, "Image socket create failed");
-        return;
+    if (!img_parity) {
+        img_parity = heap_caps_malloc((size_t)IMAGE_FEC_MAX_M * IMAGE_MAX_PAYLOAD, MALLOC_CAP_SPIRAM);
+        if (!img_parity) return;
     }
+    image_fec_encode_block(&img_gf, data, len, first, k, m, img_parity);
 
-    struct sockaddr_in img_addr = {
-        .sin_family = AF_INET,
-        .sin_port   = htons(IMAGE_PORT),
-        .sin_addr.s_addr = inet_addr(SERVER_IP),
-    };
-
-    uint16_t total_chunks = (len + MAX_PAYLOAD - 1) / MAX_PAYLOAD;
+    uint8_t packet[sizeof(jpeg_hdr_t) + sizeof(image_fec_hdr_t) + IMAGE_MAX_PAYLOAD];
+    jpeg_hdr_t *hdr = (jpeg_hdr_t *)packet;
+    image_fec_hdr_t *fh = (image_fec_hdr_t *)(packet + sizeof(jpeg_hdr_t));
 
-    for (uint16_t i = 0; i < total_chunks; i++) {
-        uint8_t packet[sizeof(jpeg_hdr_t) + MAX_PAYLOAD];
+    fh->block_k = IMG_FEC_BLOCK;
+    fh->parity_m = m;
+    fh->last_len = len - (size_t)(total_chunks - 1) * IMAGE_MAX_PAYLOAD;
 
-        jpeg_hdr_t *hdr = (jpeg_hdr_t *)packet;
+    for (unsigned r = 0; r < m; r++) {
         hdr->frame_id = frame_id;
-        hdr->chunk_id = i;
+        hdr->chunk_id = total_chunks + block * m + r;
         hdr->total_chunks = total_chunks;
-
-        size_t offset = i * MAX_PAYLOAD;
-        size_t chunk = (len - offset > MAX_PAYLOAD) ? MAX_PAYLOAD : (len - offset);
-        hdr->payload_size = chunk;
-
-        memcpy(packet + sizeof(jpeg_hdr_t), data + offset, chunk);
+        hdr->payload_size = sizeof(image_fec_hdr_t) + IMAGE_MAX_PAYLOAD;
+        hdr->event_id = event_id;
+        memcpy(fh + 1, img_parity + (size_t)r * IMAGE_MAX_PAYLOAD, IMAGE_MAX_PAYLOAD);
 
         sendto(img_sock,
                packet,
-               sizeof(jpeg_hdr_t) + chunk,
+               sizeof(packet),
                0,
                (struct sockaddr *)&img_addr,
                sizeof(img_addr));
     }
+}
 
-    close(img_sock);
+/* keep a copy of the frame so missing chunks can be resent later */
+static void cache_frame(uint16_t frame_id, uint32_t event_id, const uint8_t *data, size_t len)
+{
+    img_cache_t *c = &img_cache[frame_id % IMG_CACHE_FRAMES];
+
+    xSemaphoreTake(img_cache_lock, portMAX_DELAY);
+    if (c->cap < len) {
+        uint8_t *p = heap_caps_realloc(c->buf, len, MALLOC_CAP_SPIRAM);
+        if (!p) {
+            c->len = 0;
+            xSemaphoreGive(img_cache_lock);
+            ESP_LOGW(TAG, "No PSRAM for retransmit cache (%d bytes)", len);
+            return;
+        }
+        c->buf = p;
+        c->cap = len;
+    }
+    memcpy(c->buf, data, len);
+    c->frame_id = frame_id;
+    c->event_id = event_id;
+    c->len = len;
+    xSemaphoreGive(img_cache_lock);
+}
+
+/* receiver → camera: resend the chunks a NACK names, if still cached */
+static void image_nack_task(void *arg)
+{
+    image_nack_t nack;
+
+    while (1) {
+        int len = recv(img_sock, &nack, sizeof(nack), 0);
+        if (len < (int)IMAGE_NACK_HDR_SIZE || nack.magic != IMAGE_NACK_MAGIC)
+            continue;
+
+        img_cache_t *c = &img_cache[nack.frame_id % IMG_CACHE_FRAMES];
+        int resent = 0;
+
+        xSemaphoreTake(img_cache_lock, portMAX_DELAY);
+        if (c->len && c->frame_id == nack.frame_id) {
+            uint16_t total_chunks = (c->len + IMAGE_MAX_PAYLOAD - 1) / IMAGE_MAX_PAYLOAD;
+            for (size_t i = 0; i < IMAGE_NACK_MAX_BITMAP * 8; i++) {
+                if (!image_nack_wants(&nack, len, i)) continue;
+                send_chunk(c->buf, c->len, c->frame_id, nack.base_chunk + i, total_chunks, c->event_id);
+                resent++;
+            }
+        }
+        xSemaphoreGive(img_cache_lock);
+
+        ESP_LOGI(TAG, "NACK frame=%d: resent %d chunks", nack.frame_id, resent);
+    }
+}
+
+void WiFi_SendJPEG(const uint8_t *data, size_t len, uint32_t event_id)
+{
+    static uint16_t frame_id = 0;
+    frame_id++;
+
+    if (img_sock < 0) {
+        ESP_LOGE(TAG, "Image socket not ready");
+        return;
+    }
+
+    cache_frame(frame_id, event_id, data, len);
+
+    uint16_t total_chunks = (len + IMAGE_MAX_PAYLOAD - 1) / IMAGE_MAX_PAYLOAD;
+
+    for (uint16_t i = 0; i < total_chunks; i++) {
+        send_chunk(data, len, frame_id, i, total_chunks, event_id);
+
+        // close of a block: its repair chunks follow immediately
+        if (IMG_FEC_PERCENT > 0 && ((i + 1) % IMG_FEC_BLOCK == 0 || i + 1 == total_chunks)) {
+            unsigned block = i / IMG_FEC_BLOCK;
+            send_parity(data, len, frame_id, total_chunks, event_id,
+                        block, block * IMG_FEC_BLOCK, i + 1 - block * IMG_FEC_BLOCK);
+        }
+    }
 
-    ESP_LOGI(TAG, "JPEG sent: size=%d bytes, chunks=%d", len, total_chunks);
+    ESP_LOGI(TAG, "JPEG sent: size=%d bytes, chunks=%d, event=%u", len, total_chunks, event_id);
 }
@@ -14,7 +14,8 @@ void WiFi_SendEvent(const char *msg);
 
 /* Command RX task start */
 void App_WiFi_StartCmdRxTask(void);
-void WiFi_SendJPEG(const uint8_t *data, size_t len);
+/* event_id: from "CAPTURE:<id>", carried in every image chunk header */
+void WiFi_SendJPEG(const uint8_t *data, size_t len, uint32_t event_id);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,353 @@
+#pragma once
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include <zlib.h>                   // link with -lz
+
+/* brotli is opt-in: build with -DASSET_BROTLI -lbrotlienc */
+#if defined(ASSET_BROTLI) && __has_include(<brotli/encode.h>)
+#include <brotli/encode.h>
+#define ASSET_HAS_BROTLI 1
+#endif
+
+/*
+   The web/ tree, held in memory for dashboard_server.
+
+   Every file is read once, with gzip (and brotli) variants compressed
+   ahead of time for text types. A response is then just a choice of
+   variant by Accept-Encoding and a pointer into an immutable snapshot.
+   Each variant has its own strong ETag (content hash plus encoding),
+   so If-None-Match can be answered with a 304.
+
+   An inotify watch on the tree rebuilds the snapshot when files change.
+   Readers keep the snapshot they started with until they finish, so a
+   reload never disturbs a response in flight.
+
+   If web_assets.h exists at build time (made by asset_embed from web/),
+   the tree is compiled in instead: variants and ETags were computed by
+   the generator, and bodies point straight at the constant arrays, so
+   nothing is read or compressed at startup. A directory given to
+   AssetCache still takes precedence, for working on the pages.
+*/
+
+#define ASSET_ROOT          "web"
+#define ASSET_CACHE_CONTROL "public, max-age=300"    // pages get no-cache
+#define ASSET_RELOAD_MS     100         // settle time after a change
+#define ASSET_MIN_GAIN      64          // keep a variant only if it saves this much
+
+enum AssetEncoding { ENC_IDENTITY, ENC_GZIP, ENC_BROTLI, ENC_COUNT };
+
+struct Asset {
+    const char*      mime;
+    const char*      cache_control;
+    std::string_view body[ENC_COUNT];   // empty = no such variant (identity always set)
+    std::string      etag[ENC_COUNT];
+    std::shared_ptr<const std::string> own[ENC_COUNT];  // storage behind body, read from disk
+};
+
+/* one file of web_assets.h; a variant that wasn't worth keeping has no etag */
+struct EmbeddedAsset {
+    const char*          path;
+    const char*          mime;
+    const unsigned char* body[ENC_COUNT];
+    size_t               len[ENC_COUNT];
+    const char*          etag[ENC_COUNT];
+};
+
+/* asset_embed defines ASSET_NO_EMBEDDED: it is what writes the file */
+#if !defined(ASSET_NO_EMBEDDED) && __has_include("web_assets.h")
+#include "web_assets.h"             // EMBEDDED_ASSETS[], EMBEDDED_ASSET_COUNT
+#define ASSET_HAS_EMBEDDED 1
+#endif
+
+/* "" (the compiled-in tree) if there is one, else web/ on disk */
+inline const char* asset_default_root()
+{
+#ifdef ASSET_HAS_EMBEDDED
+    return "";
+#else
+    return ASSET_ROOT;
+#endif
+}
+
+using AssetMap = std::unordered_map<std::string, Asset>;    // "/css/style.css" -> asset
+
+inline const char* asset_mime(const std::string& path)
+{
+    static const struct { const char* ext; const char* mime; } types[] = {
+        {".html", "text/html; charset=utf-8"},
+        {".css",  "text/css; charset=utf-8"},
+        {".js",   "application/javascript; charset=utf-8"},
+        {".json", "application/json"},
+        {".svg",  "image/svg+xml"},
+        {".jpg",  "image/jpeg"},
+        {".jpeg", "image/jpeg"},
+        {".png",  "image/png"},
+        {".ico",  "image/x-icon"},
+    };
+    size_t dot = path.rfind('.');
+    if (dot != std::string::npos)
+        for (const auto& t : types)
+            if (!strcasecmp(path.c_str() + dot, t.ext)) return t.mime;
+    return "application/octet-stream";
+}
+
+/* JPEG/PNG are compressed already */
+inline bool asset_compressible(const char* mime)
+{
+    return !strncmp(mime, "text/", 5) || strstr(mime, "javascript") || strstr(mime, "json") ||
+           strstr(mime, "svg");
+}
+
+inline std::string asset_gzip(const std::string& in)
+{
+    z_stream z{};
+    if (deflateInit2(&z, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+        return "";
+
+    std::string out(deflateBound(&z, in.size()), '\0');
+    z.next_in   = (Bytef*)in.data();
+    z.avail_in  = (uInt)in.size();
+    z.next_out  = (Bytef*)&out[0];
+    z.avail_out = (uInt)out.size();
+    int rc = deflate(&z, Z_FINISH);
+    out.resize(z.total_out);
+    deflateEnd(&z);
+    return rc == Z_STREAM_END ? out : "";
+}
+
+inline std::string asset_brotli(const std::string& in)
+{
+#ifdef ASSET_HAS_BROTLI
+    size_t n = BrotliEncoderMaxCompressedSize(in.size());
+    std::string out(n, '\0');
+    if (!n || !BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                                     in.size(), (const uint8_t*)in.data(), &n, (uint8_t*)&out[0]))
+        return "";
+    out.resize(n);
+    return out;
+#else
+    (void)in;
+    return "";
+#endif
+}
+
+/* 64-bit FNV-1a of the content: the strong validator for all variants */
+inline uint64_t asset_hash(const std::string& s)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char c : s) h = (h ^ c) * 0x100000001b3ull;
+    return h;
+}
+
+inline const char* asset_cache_control(const char* mime)
+{
+    return strstr(mime, "text/html") ? "no-cache" : ASSET_CACHE_CONTROL;
+}
+
+inline Asset asset_build(const std::string& path, std::string content)
+{
+    static const char* suffix[ENC_COUNT] = {"", "-gz", "-br"};
+
+    Asset a;
+    a.mime = asset_mime(path);
+    a.cache_control = asset_cache_control(a.mime);
+
+    std::string body[ENC_COUNT];
+    if (asset_compressible(a.mime)) {
+        body[ENC_GZIP]   = asset_gzip(content);
+        body[ENC_BROTLI] = asset_brotli(content);
+        for (int e = ENC_GZIP; e < ENC_COUNT; e++)
+            if (body[e].size() + ASSET_MIN_GAIN > content.size()) body[e].clear();
+    }
+
+    char tag[32];
+    snprintf(tag, sizeof(tag), "%016llx", (unsigned long long)asset_hash(content));
+    body[ENC_IDENTITY] = std::move(content);
+    for (int e = 0; e < ENC_COUNT; e++) {
+        if (body[e].empty() && e != ENC_IDENTITY) continue;
+        a.own[e]  = std::make_shared<const std::string>(std::move(body[e]));
+        a.body[e] = *a.own[e];
+        a.etag[e] = std::string("\"") + tag + suffix[e] + "\"";
+    }
+    return a;
+}
+
+/* no copy: the bodies stay in the compiled-in arrays */
+inline Asset asset_from_embedded(const EmbeddedAsset& e)
+{
+    Asset a;
+    a.mime = e.mime;
+    a.cache_control = asset_cache_control(e.mime);
+    for (int i = 0; i < ENC_COUNT; i++) {
+        if (!e.etag[i]) continue;
+        if (e.len[i]) a.body[i] = std::string_view((const char*)e.body[i], e.len[i]);
+        a.etag[i] = e.etag[i];
+    }
+    return a;
+}
+
+/* ================= LOOKUP ================= */
+/* best variant the client accepts (q=0 is honoured, other weights are not) */
+inline AssetEncoding asset_pick(const Asset& a, const std::string& accept_encoding)
+{
+    auto accepts = [&](const char* name) {
+        size_t n = strlen(name);
+        for (size_t p = 0; (p = accept_encoding.find(name, p)) != std::string::npos; p += n) {
+            bool start = p == 0 || accept_encoding[p - 1] == ' ' || accept_encoding[p - 1] == ',';
+            bool end   = p + n == accept_encoding.size() || accept_encoding[p + n] == ',' ||
+                         accept_encoding[p + n] == ';' || accept_encoding[p + n] == ' ';
+            if (!start || !end) continue;
+            size_t stop = accept_encoding.find(',', p);
+            std::string params = accept_encoding.substr(p + n, stop == std::string::npos ? stop : stop - p - n);
+            return params.find("q=0") == std::string::npos || params.find("q=0.") != std::string::npos;
+        }
+        return false;
+    };
+
+    if (!a.body[ENC_BROTLI].empty() && accepts("br"))   return ENC_BROTLI;
+    if (!a.body[ENC_GZIP].empty()   && accepts("gzip")) return ENC_GZIP;
+    return ENC_IDENTITY;
+}
+
+/* If-None-Match: "*", or a list of tags (weak comparison, as RFC 9110 asks) */
+inline bool asset_not_modified(const std::string& if_none_match, const std::string& etag)
+{
+    if (if_none_match.empty()) return false;
+    if (if_none_match == "*") return true;
+
+    for (size_t p = 0; p < if_none_match.size(); ) {
+        size_t q = if_none_match.find(',', p);
+        if (q == std::string::npos) q = if_none_match.size();
+        std::string tag = if_none_match.substr(p, q - p);
+        tag.erase(0, tag.find_first_not_of(' '));
+        tag.erase(tag.find_last_not_of(' ') + 1);
+        if (!tag.compare(0, 2, "W/")) tag.erase(0, 2);
+        if (tag == etag) return true;
+        p = q + 1;
+    }
+    return false;
+}
+
+/* ================= CACHE ================= */
+class AssetCache {
+public:
+    /* root "": the compiled-in tree (web_assets.h) */
+    explicit AssetCache(std::string root = asset_default_root()) : root_(std::move(root)) {}
+
+    /* read the whole tree; returns the number of files */
+    size_t load()
+    {
+        auto next = std::make_shared<AssetMap>();
+        if (root_.empty()) {
+#ifdef ASSET_HAS_EMBEDDED
+            for (size_t i = 0; i < EMBEDDED_ASSET_COUNT; i++)
+                (*next)[EMBEDDED_ASSETS[i].path] = asset_from_embedded(EMBEDDED_ASSETS[i]);
+#endif
+        } else {
+            walk("", *next);
+        }
+
+        size_t raw = 0, gz = 0, br = 0;
+        for (const auto& kv : *next) {
+            raw += kv.second.body[ENC_IDENTITY].size();
+            gz  += kv.second.body[ENC_GZIP].size();
+            br  += kv.second.body[ENC_BROTLI].size();
+        }
+        std::atomic_store(&snap_, std::shared_ptr<const AssetMap>(std::move(next)));
+
+        std::shared_ptr<const AssetMap> s = snapshot();
+        std::cout << "[DASH] Loaded " << s->size() << " web assets "
+                  << (root_.empty() ? "compiled in" : "from " + root_ + "/") << " (" << raw / 1024
+                  << " KiB, gzip " << gz / 1024 << " KiB, brotli " << br / 1024 << " KiB)\n";
+        return s->size();
+    }
+
+    /* hold on to the result for as long as its bodies are in use */
+    std::shared_ptr<const AssetMap> snapshot() const { return std::atomic_load(&snap_); }
+
+    /* reload on change; runs until the process exits */
+    void watch()
+    {
+        if (root_.empty()) return;      // compiled in: nothing to watch
+
+        int fd = inotify_init1(IN_CLOEXEC);
+        if (fd < 0) {
+            perror("[DASH] inotify");
+            return;
+        }
+        std::thread([this, fd] {
+            add_watches(fd, "");
+            char buf[4096];
+            for (;;) {
+                if (read(fd, buf, sizeof(buf)) <= 0) continue;
+
+                // editors and unzip write in bursts: let it settle, then reload once
+                pollfd p = {fd, POLLIN, 0};
+                while (poll(&p, 1, ASSET_RELOAD_MS) > 0)
+                    if (read(fd, buf, sizeof(buf)) <= 0) break;
+
+                add_watches(fd, "");     // picks up new directories
+                load();
+            }
+        }).detach();
+    }
+
+private:
+    void walk(const std::string& rel, AssetMap& out) const
+    {
+        DIR* d = opendir((root_ + rel).c_str());
+        if (!d) return;
+
+        while (dirent* e = readdir(d)) {
+            if (e->d_name[0] == '.') continue;      // also skips editor swap files
+            std::string path = rel + "/" + e->d_name;
+
+            struct stat st;
+            if (stat((root_ + path).c_str(), &st) != 0) continue;
+            if (S_ISDIR(st.st_mode)) {
+                walk(path, out);
+            } else if (S_ISREG(st.st_mode)) {
+                std::ifstream f(root_ + path, std::ios::binary);
+                std::string content((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+                out[path] = asset_build(path, std::move(content));
+            }
+        }
+        closedir(d);
+    }
+
+    void add_watches(int fd, const std::string& rel) const
+    {
+        inotify_add_watch(fd, (root_ + rel).c_str(),
+                          IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO);
+
+        DIR* d = opendir((root_ + rel).c_str());
+        if (!d) return;
+        while (dirent* e = readdir(d)) {
+            if (e->d_name[0] == '.') continue;
+            std::string path = rel + "/" + e->d_name;
+            struct stat st;
+            if (stat((root_ + path).c_str(), &st) == 0 && S_ISDIR(st.st_mode)) add_watches(fd, path);
+        }
+        closedir(d);
+    }
+
+    std::string                     root_;
+    std::shared_ptr<const AssetMap> snap_ = std::make_shared<const AssetMap>();
+};
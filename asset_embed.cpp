@@ -0,0 +1,130 @@
+/*
+   Compiles the web/ tree into web_assets.h for dashboard_server (see
+   asset_cache.h). Every file becomes constexpr byte arrays: the file
+   itself and its gzip (and brotli) variants, with the content type and
+   ETags. These are made by the same code the server uses for a tree on
+   disk, so responses are identical either way.
+
+   Rerun it whenever web/ changes. With no web_assets.h the server reads
+   web/ at startup as before.
+
+   g++ -std=c++17 -O2 asset_embed.cpp -o asset_embed -lz [-DASSET_BROTLI -lbrotlienc]
+   ./asset_embed [--from web] [--out web_assets.h]
+*/
+#define ASSET_NO_EMBEDDED       // never include the file being written
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "asset_cache.h"
+
+#define EMBED_BYTES_PER_LINE    16
+
+/* C string literal, quotes included */
+static std::string c_string(const std::string& s)
+{
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static void write_bytes(std::ostream& out, const std::string& name, std::string_view data)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    out << "inline constexpr unsigned char " << name << "[] = {";
+    for (size_t i = 0; i < data.size(); i++) {
+        out << (i % EMBED_BYTES_PER_LINE ? "" : "\n    ");
+        unsigned char b = (unsigned char)data[i];
+        out << "0x" << hex[b >> 4] << hex[b & 15] << ',';
+    }
+    out << "\n};\n";
+}
+
+static void usage(const char* p)
+{
+    fprintf(stderr, "usage: %s [--from DIR] [--out FILE]\n", p);
+}
+
+int main(int argc, char* argv[])
+{
+    std::string from = ASSET_ROOT, out_path = "web_assets.h";
+
+    for (int i = 1; i < argc; i++) {
+        auto arg = [&](const char* name) { return !strcmp(argv[i], name) && i + 1 < argc; };
+
+        if (arg("--from"))      from = argv[++i];
+        else if (arg("--out"))  out_path = argv[++i];
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    AssetCache cache(from);
+    cache.load();
+    std::shared_ptr<const AssetMap> assets = cache.snapshot();
+    if (assets->empty()) {
+        std::cerr << "[EMBED] no files under " << from << '\n';
+        return 1;
+    }
+
+    // sorted, so the output only changes when a file does
+    std::vector<std::string> paths;
+    for (const auto& kv : *assets) paths.push_back(kv.first);
+    std::sort(paths.begin(), paths.end());
+
+    std::string tmp = out_path + ".tmp";
+    std::ofstream out(tmp, std::ios::binary);
+    if (!out) {
+        std::cerr << "[EMBED] cannot write " << tmp << '\n';
+        return 1;
+    }
+
+    out << "/* generated by asset_embed from " << from << "/: do not edit, rerun it */\n"
+        << "#pragma once\n#include <cstddef>\n\n";
+
+    for (size_t n = 0; n < paths.size(); n++) {
+        const Asset& a = assets->at(paths[n]);
+        out << "// " << paths[n] << '\n';
+        for (int e = 0; e < ENC_COUNT; e++)
+            if (!a.body[e].empty())
+                write_bytes(out, "web_asset_" + std::to_string(n) + "_" + std::to_string(e), a.body[e]);
+        out << '\n';
+    }
+
+    out << "inline constexpr EmbeddedAsset EMBEDDED_ASSETS[] = {\n";
+    for (size_t n = 0; n < paths.size(); n++) {
+        const Asset& a = assets->at(paths[n]);
+        std::string body, len, etag;
+        for (int e = 0; e < ENC_COUNT; e++) {
+            const char* sep = e ? ", " : "";
+            body += sep + (a.body[e].empty() ? std::string("nullptr")
+                                             : "web_asset_" + std::to_string(n) + "_" + std::to_string(e));
+            len  += sep + std::to_string(a.body[e].size());
+            etag += sep + (a.etag[e].empty() ? std::string("nullptr") : c_string(a.etag[e]));
+        }
+        out << "    {" << c_string(paths[n]) << ", " << c_string(a.mime) << ",\n"
+            << "     {" << body << "},\n"
+            << "     {" << len << "},\n"
+            << "     {" << etag << "}},\n";
+    }
+    out << "};\n\ninline constexpr size_t EMBEDDED_ASSET_COUNT = "
+        << "sizeof(EMBEDDED_ASSETS) / sizeof(EMBEDDED_ASSETS[0]);\n";
+
+    out.close();
+    if (!out || rename(tmp.c_str(), out_path.c_str()) != 0) {
+        std::cerr << "[EMBED] cannot write " << out_path << '\n';
+        return 1;
+    }
+    std::cout << "[EMBED] " << paths.size() << " files from " << from << "/ into " << out_path << '\n';
+    return 0;
+}
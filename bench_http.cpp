@@ -0,0 +1,452 @@
+/*
+   HTTP load generator for dashboard_server (and rvims_server).
+
+   Each of N connections requests a weighted mix of dashboard URLs back
+   to back (closed loop) for a fixed time, like N viewers with no think
+   time. Run it against different --threads / --keep-alive-* settings
+   of the server to compare them:
+
+   ./dashboard_server --threads 16 &
+   ./bench_http --conns 64 --duration 10 --pid $(pidof dashboard_server)
+
+   --no-keep-alive opens a connection per request. --revalidate sends
+   the ETag of the previous response for the same URL back as
+   If-None-Match, which is what browsers polling the API do (mostly
+   304s). --gzip asks for compressed assets. The default mix is the
+   pages, assets and API of the dashboard plus the newest stored image
+   (full size and thumbnail, found through /api/esp32). --path URL@WEIGHT
+   replaces it and can be given several times.
+
+   Latency is from just before the request is written to the last byte
+   of the response.
+
+   g++ -std=c++17 -O2 -pthread bench_http.cpp -o bench_http
+*/
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* ================= CONFIG ================= */
+struct Path {
+    std::string url;
+    unsigned    weight;
+};
+
+struct Opts {
+    const char*       host       = "127.0.0.1";
+    int               port       = 8080;
+    int               conns      = 16;
+    double            duration   = 10;      // seconds
+    bool              keep_alive = true;
+    bool              revalidate = false;
+    bool              gzip       = false;
+    int               pid        = 0;       // server pid, for CPU/request
+    std::vector<Path> paths;
+};
+
+#define RESP_MAX    (64u << 20)     // give up on larger responses
+
+static uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* utime + stime of a process, in seconds */
+static double proc_cpu_s(int pid)
+{
+    if (!pid) return 0;
+
+    std::ifstream f("/proc/" + std::to_string(pid) + "/stat");
+    std::string stat((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    /* fields after "(comm)": state is field 3, utime/stime are 14/15 */
+    size_t p = stat.rfind(')');
+    if (p == std::string::npos) return 0;
+
+    std::istringstream in(stat.substr(p + 2));
+    std::string tok;
+    unsigned long long utime = 0, stime = 0;
+    for (int field = 3; in >> tok && field <= 15; field++) {
+        if (field == 14) utime = strtoull(tok.c_str(), nullptr, 10);
+        if (field == 15) stime = strtoull(tok.c_str(), nullptr, 10);
+    }
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+/* ================= CLIENT ================= */
+struct Response {
+    int         status = 0;
+    size_t      bytes  = 0;         // headers + body
+    bool        close  = false;     // server will close the connection
+    std::string etag;
+    std::string body;
+};
+
+class Conn {
+public:
+    explicit Conn(const sockaddr_in& srv) : srv_(srv) {}
+    ~Conn() { drop(); }
+
+    bool open()
+    {
+        if (fd_ >= 0) return true;
+        fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int on = 1;
+        setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        timeval tv{10, 0};
+        setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        if (connect(fd_, (const sockaddr*)&srv_, sizeof(srv_)) < 0) {
+            drop();
+            return false;
+        }
+        buf_.clear();
+        opened++;
+        return true;
+    }
+
+    void drop()
+    {
+        if (fd_ >= 0) close(fd_);
+        fd_ = -1;
+    }
+
+    /* one request/response; false on any socket or protocol error */
+    bool get(const std::string& req, Response& r)
+    {
+        for (size_t off = 0; off < req.size(); ) {
+            ssize_t n = send(fd_, req.data() + off, req.size() - off, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            off += n;
+        }
+
+        size_t end;
+        while ((end = buf_.find("\r\n\r\n")) == std::string::npos)
+            if (!fill()) return false;
+        std::string head = buf_.substr(0, end + 2);
+        buf_.erase(0, end + 4);
+
+        r = Response{};
+        r.bytes = end + 4;
+        int minor;
+        if (sscanf(head.c_str(), "HTTP/1.%d %d", &minor, &r.status) != 2) return false;
+        r.close = minor == 0;       // unless it says keep-alive
+
+        long long length = -1;
+        bool chunked = false;
+        for (size_t p = head.find("\r\n") + 2; p < head.size(); ) {
+            size_t q = head.find("\r\n", p);
+            std::string line = head.substr(p, q - p);
+            p = q + 2;
+
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            std::string name = line.substr(0, colon), value = line.substr(colon + 1);
+            value.erase(0, value.find_first_not_of(' '));
+
+            if (!strcasecmp(name.c_str(), "Content-Length"))    length = atoll(value.c_str());
+            else if (!strcasecmp(name.c_str(), "ETag"))         r.etag = value;
+            else if (!strcasecmp(name.c_str(), "Transfer-Encoding"))
+                chunked = strcasestr(value.c_str(), "chunked") != nullptr;
+            else if (!strcasecmp(name.c_str(), "Connection"))
+                r.close = strcasecmp(value.c_str(), "keep-alive") != 0;
+        }
+
+        bool ok;
+        if (r.status == 304 || r.status == 204 || r.status / 100 == 1) ok = true;
+        else if (chunked)     ok = read_chunked(r);
+        else if (length >= 0) ok = read_exact((size_t)length, r);
+        else {
+            // no length: the body runs to the end of the connection
+            while (fill()) {}
+            r.body.swap(buf_);
+            r.close = true;
+            ok = true;
+        }
+        r.bytes += r.body.size();
+        return ok;
+    }
+
+private:
+    bool fill()
+    {
+        if (buf_.size() > RESP_MAX) return false;
+        char tmp[65536];
+        ssize_t n = recv(fd_, tmp, sizeof(tmp), 0);
+        if (n <= 0) return false;
+        buf_.append(tmp, n);
+        return true;
+    }
+
+    bool read_exact(size_t n, Response& r)
+    {
+        if (n > RESP_MAX) return false;
+        while (buf_.size() < n)
+            if (!fill()) return false;
+        r.body.assign(buf_, 0, n);
+        buf_.erase(0, n);
+        return true;
+    }
+
+    bool read_chunked(Response& r)
+    {
+        for (;;) {
+            size_t eol;
+            while ((eol = buf_.find("\r\n")) == std::string::npos)
+                if (!fill()) return false;
+            size_t size = strtoul(buf_.c_str(), nullptr, 16);
+            buf_.erase(0, eol + 2);
+
+            if (size == 0) {
+                // trailers, then the final blank line
+                while ((eol = buf_.find("\r\n")) != 0) {
+                    if (eol == std::string::npos) {
+                        if (!fill()) return false;
+                        continue;
+                    }
+                    buf_.erase(0, eol + 2);
+                }
+                buf_.erase(0, 2);
+                return true;
+            }
+            if (r.body.size() + size > RESP_MAX) return false;
+            while (buf_.size() < size + 2)
+                if (!fill()) return false;
+            r.body.append(buf_, 0, size);
+            buf_.erase(0, size + 2);
+        }
+    }
+
+public:
+    uint64_t    opened = 0;
+
+private:
+    sockaddr_in srv_;
+    int         fd_ = -1;
+    std::string buf_;               // received, not yet parsed
+};
+
+static std::string request(const Opts& o, const std::string& url, const std::string& etag)
+{
+    std::string r = "GET " + url + " HTTP/1.1\r\nHost: " + o.host + ":" + std::to_string(o.port) +
+                    "\r\nUser-Agent: bench_http\r\n";
+    r += o.keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    if (o.gzip) r += "Accept-Encoding: gzip\r\n";
+    if (!etag.empty()) r += "If-None-Match: " + etag + "\r\n";
+    return r + "\r\n";
+}
+
+/* ================= WORKERS ================= */
+struct Stats {
+    std::vector<std::vector<uint64_t>> lat;     // ns, by path
+    uint64_t ok = 0, not_modified = 0, client_err = 0, server_err = 0, errors = 0;
+    uint64_t connects = 0, bytes = 0;
+};
+
+static void client_thread(const Opts& o, const sockaddr_in& srv, int id, uint64_t end_ns, Stats& st)
+{
+    std::mt19937 rng(id * 7919 + 1);
+    std::vector<unsigned> pick;                 // path index, repeated by weight
+    for (size_t p = 0; p < o.paths.size(); p++)
+        pick.insert(pick.end(), o.paths[p].weight, (unsigned)p);
+    std::uniform_int_distribution<size_t> any(0, pick.size() - 1);
+
+    std::vector<std::string> etags(o.paths.size());
+    st.lat.resize(o.paths.size());
+
+    Conn c(srv);
+    Response r;
+    while (now_ns() < end_ns) {
+        unsigned p = pick[any(rng)];
+        std::string req = request(o, o.paths[p].url, o.revalidate ? etags[p] : "");
+
+        uint64_t t0 = now_ns();
+        if (!c.open()) {
+            st.errors++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        if (!c.get(req, r)) {
+            // a kept-alive connection the server closed in between: retry once on a new one
+            c.drop();
+            if (!c.open() || !c.get(req, r)) {
+                c.drop();
+                st.errors++;
+                continue;
+            }
+        }
+        st.lat[p].push_back(now_ns() - t0);
+        st.bytes += r.bytes;
+
+        if (r.status == 304)            st.not_modified++;
+        else if (r.status / 100 == 2)   st.ok++;
+        else if (r.status / 100 == 4)   st.client_err++;
+        else                            st.server_err++;
+        if (!r.etag.empty()) etags[p] = r.etag;
+
+        if (!o.keep_alive || r.close) c.drop();
+    }
+    st.connects = c.opened;
+}
+
+/* ================= REPORT ================= */
+static void report(const char* name, std::vector<uint64_t> v, double secs)
+{
+    if (v.empty()) {
+        printf("%-34s: no samples\n", name);
+        return;
+    }
+    std::sort(v.begin(), v.end());
+    auto pct = [&](double p) { return v[std::min(v.size() - 1, (size_t)(p * v.size()))] / 1000.0; };
+
+    printf("%-34s: %8.0f req/s  p50=%.0fus  p90=%.0fus  p99=%.0fus  p999=%.0fus  max=%.0fus\n",
+           name, v.size() / secs, pct(0.50), pct(0.90), pct(0.99), pct(0.999), v.back() / 1000.0);
+}
+
+/* newest stored image from /api/esp32, for the default mix */
+static std::string newest_image(const Opts& o, const sockaddr_in& srv)
+{
+    Conn c(srv);
+    Response r;
+    Opts plain = o;
+    plain.gzip = false;
+    if (!c.open() || !c.get(request(plain, "/api/esp32", ""), r) || r.status != 200) return "";
+
+    size_t p = r.body.find("\"image\"");
+    if (p == std::string::npos) return "";
+    size_t a = r.body.find('"', r.body.find(':', p) + 1);
+    size_t b = r.body.find('"', a + 1);
+    return a == std::string::npos || b == std::string::npos ? "" : r.body.substr(a + 1, b - a - 1);
+}
+
+static void usage(const char* p)
+{
+    fprintf(stderr,
+            "usage: %s [--host IP] [--port N] [--conns N] [--duration S]\n"
+            "          [--no-keep-alive] [--revalidate] [--gzip] [--pid SERVER_PID]\n"
+            "          [--path URL[@WEIGHT]]...\n", p);
+}
+
+int main(int argc, char* argv[])
+{
+    Opts o;
+
+    for (int i = 1; i < argc; i++) {
+        auto arg = [&](const char* name) { return !strcmp(argv[i], name) && i + 1 < argc; };
+
+        if      (arg("--host"))                     o.host     = argv[++i];
+        else if (arg("--port"))                     o.port     = atoi(argv[++i]);
+        else if (arg("--conns"))                    o.conns    = std::max(1, atoi(argv[++i]));
+        else if (arg("--duration"))                 o.duration = atof(argv[++i]);
+        else if (arg("--pid"))                      o.pid      = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--no-keep-alive")) o.keep_alive = false;
+        else if (!strcmp(argv[i], "--revalidate"))  o.revalidate = true;
+        else if (!strcmp(argv[i], "--gzip"))        o.gzip = true;
+        else if (arg("--path")) {
+            std::string s = argv[++i];
+            size_t at = s.rfind('@');
+            unsigned w = 1;
+            if (at != std::string::npos && s.find_first_not_of("0123456789", at + 1) == std::string::npos) {
+                w = std::max(1, atoi(s.c_str() + at + 1));
+                s.resize(at);
+            }
+            o.paths.push_back(Path{s, w});
+        }
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    sockaddr_in srv{};
+    srv.sin_family = AF_INET;
+    srv.sin_port   = htons(o.port);
+    if (inet_pton(AF_INET, o.host, &srv.sin_addr) != 1) {
+        hostent* h = gethostbyname(o.host);
+        if (!h) {
+            fprintf(stderr, "[BENCH] unknown host %s\n", o.host);
+            return 1;
+        }
+        memcpy(&srv.sin_addr, h->h_addr_list[0], sizeof(srv.sin_addr));
+    }
+
+    /* ---------- URL MIX ---------- */
+    if (o.paths.empty()) {
+        o.paths = {{"/", 1}, {"/stm32", 1}, {"/esp32", 1},
+                   {"/js/dashboard.js", 1}, {"/css/style.css", 1},
+                   {"/api/stm32", 4}, {"/api/esp32", 4}};
+        std::string img = newest_image(o, srv);
+        if (!img.empty()) {
+            o.paths.push_back({"/images/" + img + "?size=thumb", 2});
+            o.paths.push_back({"/images/" + img, 1});
+        } else {
+            printf("[BENCH] no stored image from /api/esp32, leaving /images out\n");
+        }
+    }
+    printf("[BENCH] %d connections to %s:%d for %.0fs, %s%s%s\n", o.conns, o.host, o.port,
+           o.duration, o.keep_alive ? "keep-alive" : "connection per request",
+           o.revalidate ? ", revalidating" : "", o.gzip ? ", gzip" : "");
+
+    /* ---------- RUN ---------- */
+    std::vector<Stats> stats(o.conns);
+    double   cpu0   = proc_cpu_s(o.pid);
+    uint64_t start  = now_ns();
+    uint64_t end_ns = start + (uint64_t)(o.duration * 1e9);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < o.conns; i++)
+        threads.emplace_back(client_thread, std::cref(o), std::cref(srv), i, end_ns, std::ref(stats[i]));
+    for (auto& t : threads) t.join();
+
+    double secs = (now_ns() - start) / 1e9;
+    double cpu1 = proc_cpu_s(o.pid);
+
+    /* ---------- REPORT ---------- */
+    Stats all;
+    all.lat.resize(o.paths.size());
+    for (auto& s : stats) {
+        for (size_t p = 0; p < o.paths.size(); p++)
+            all.lat[p].insert(all.lat[p].end(), s.lat[p].begin(), s.lat[p].end());
+        all.ok += s.ok;
+        all.not_modified += s.not_modified;
+        all.client_err += s.client_err;
+        all.server_err += s.server_err;
+        all.errors += s.errors;
+        all.connects += s.connects;
+        all.bytes += s.bytes;
+    }
+    std::vector<uint64_t> total;
+    for (auto& v : all.lat) total.insert(total.end(), v.begin(), v.end());
+
+    printf("requests              : %zu in %.2fs (%.0f req/s, %.1f MiB/s)\n",
+           total.size(), secs, total.size() / secs, all.bytes / secs / (1 << 20));
+    printf("responses             : %llu 2xx, %llu 304, %llu 4xx, %llu 5xx, %llu failed\n",
+           (unsigned long long)all.ok, (unsigned long long)all.not_modified,
+           (unsigned long long)all.client_err, (unsigned long long)all.server_err,
+           (unsigned long long)all.errors);
+    printf("connections opened    : %llu\n", (unsigned long long)all.connects);
+    if (o.pid && !total.empty())
+        printf("server cpu            : %.2fs, %.1f us/request\n",
+               cpu1 - cpu0, (cpu1 - cpu0) * 1e6 / total.size());
+
+    report("all", total, secs);
+    for (size_t p = 0; p < o.paths.size(); p++)
+        report(o.paths[p].url.c_str(), all.lat[p], secs);
+    return 0;
+}
@@ -0,0 +1,418 @@
+/*
+   TCP ingest load generator and latency benchmark for event_server.
+
+   Opens N simulated STM32 connections, replays EVENT traffic at a set
+   rate/burst/fragmentation pattern and stands in for the ESP32 by
+   listening on the CAPTURE port. Everything runs on localhost:
+
+   ./event_server --esp32 127.0.0.1 &
+   ./bench_ingest --conns 200 --rate 50 --duration 10 --pid $(pidof event_server)
+
+   Latency is measured from just before send() to
+     - the event appearing in the shared-memory live state that backs
+       /api/stm32 (see live_state.h), and
+     - the CAPTURE datagram reaching the UDP sink.
+   The server handles events one at a time, so the n-th event published
+   to the live ring is the one that caused the n-th CAPTURE.
+
+   Each event carries its benchmark index: in v2 frames as the board
+   sequence number, in text lines folded into LAT/LON (8.0000.. and
+   68.0000.. upwards, 4 decimals as the firmware prints them).
+
+   g++ -std=c++17 -O2 -pthread bench_ingest.cpp -o bench_ingest
+*/
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_proto.h"
+#include "live_state.h"
+
+/* ================= CONFIG ================= */
+enum Frag  { FRAG_NONE, FRAG_COALESCE, FRAG_SPLIT, FRAG_RANDOM };
+enum Proto { PROTO_TEXT, PROTO_V2 };
+
+struct Opts {
+    const char* host     = "127.0.0.1";
+    int         port     = 5000;
+    int         cap_port = 9100;
+    int         conns    = 16;
+    double      rate     = 10;      // events/s per connection, 0 = flat out
+    int         burst    = 1;       // events sent back to back per tick
+    double      duration = 10;      // seconds
+    int         threads  = 1;
+    Frag        frag     = FRAG_NONE;
+    Proto       proto    = PROTO_TEXT;
+    int         pid      = 0;       // event_server pid, for CPU/event
+    uint64_t    max_events = 20000000;
+};
+
+#define LAT_SPAN    200000          // indices folded into the 4th decimal of LAT
+
+static uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* utime + stime of a process, in seconds */
+static double proc_cpu_s(int pid)
+{
+    if (!pid) return 0;
+
+    std::ifstream f("/proc/" + std::to_string(pid) + "/stat");
+    std::string stat((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    /* fields after "(comm)": state is field 3, utime/stime are 14/15 */
+    size_t p = stat.rfind(')');
+    if (p == std::string::npos) return 0;
+
+    std::istringstream in(stat.substr(p + 2));
+    std::string tok;
+    unsigned long long utime = 0, stime = 0;
+    for (int field = 3; in >> tok && field <= 15; field++) {
+        if (field == 14) utime = strtoull(tok.c_str(), nullptr, 10);
+        if (field == 15) stime = strtoull(tok.c_str(), nullptr, 10);
+    }
+    return (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+/* ================= SHARED RESULTS ================= */
+struct Results {
+    std::unique_ptr<std::atomic<uint64_t>[]> send_ns;   // by event index
+    std::atomic<uint64_t> next_index{0};
+    std::atomic<bool>     senders_done{false};
+    std::atomic<bool>     stop{false};
+
+    std::vector<uint64_t> publish_order;    // event index, in live-ring order
+    std::vector<uint64_t> publish_lat;      // ns
+    std::vector<uint64_t> capture_ns;       // receive time of each CAPTURE
+};
+
+/* ================= SENDERS ================= */
+static void encode_event(const Opts& o, uint64_t k, uint32_t dev, std::string& out)
+{
+    if (o.proto == PROTO_V2) {
+        event_frame_v2_t f;
+        memset(&f, 0, sizeof(f));
+        f.device_id = dev;
+        f.seq       = (uint32_t)k;
+        f.type      = EVENT_V2_TYPE_2G;
+        f.flags     = EVENT_V2_FLAG_FIX;
+        f.lat_e7    = 286141000;
+        f.lon_e7    = 772092000;
+        f.epoch     = (uint32_t)time(nullptr);
+        f.peak_mg   = 2100;
+        event_v2_seal(&f);
+        out.append((const char*)&f, sizeof(f));
+        return;
+    }
+
+    time_t t = time(nullptr) + 19800;       // boards print IST
+    tm g;
+    gmtime_r(&t, &g);
+
+    char line[128];
+    int n = snprintf(line, sizeof(line),
+                     "EVENT:2G,LAT:%.4f,LON:%.4f,DATE:%02d-%02d-%04d,TIME:%02d:%02d:%02d\r\n",
+                     8.0 + (double)(k % LAT_SPAN) / 10000.0,
+                     68.0 + (double)(k / LAT_SPAN) / 10000.0,
+                     g.tm_mday, g.tm_mon + 1, g.tm_year + 1900,
+                     g.tm_hour, g.tm_min, g.tm_sec);
+    out.append(line, n);
+}
+
+static bool send_all(int fd, const char* p, size_t n)
+{
+    while (n) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w <= 0) return false;
+        p += w;
+        n -= w;
+    }
+    return true;
+}
+
+struct SimBoard {
+    int      fd = -1;
+    uint32_t dev = 0;
+    uint64_t next_ns = 0;
+};
+
+static void sender_thread(const Opts& o, Results& r, std::vector<SimBoard> boards, uint64_t end_ns)
+{
+    std::mt19937 rng((unsigned)boards.size() * 7919 + boards[0].dev);
+    uint64_t period = o.rate > 0 ? (uint64_t)(1e9 * o.burst / o.rate) : 0;
+
+    std::string buf;
+    std::vector<size_t> ends;
+
+    while (now_ns() < end_ns) {
+        uint64_t now = now_ns(), wake = end_ns;
+
+        for (auto& b : boards) {
+            if (b.fd < 0) continue;
+            if (period && b.next_ns > now) {
+                wake = std::min(wake, b.next_ns);
+                continue;
+            }
+
+            buf.clear();
+            ends.clear();
+            uint64_t k0 = r.next_index.fetch_add(o.burst);
+            if (k0 + o.burst > o.max_events) { r.next_index -= o.burst; goto out; }
+
+            for (int i = 0; i < o.burst; i++) {
+                encode_event(o, k0 + i, b.dev, buf);
+                ends.push_back(buf.size());
+            }
+
+            uint64_t t = now_ns();
+            for (int i = 0; i < o.burst; i++)
+                r.send_ns[k0 + i].store(t, std::memory_order_relaxed);
+
+            bool ok = true;
+            switch (o.frag) {
+            case FRAG_COALESCE:
+                ok = send_all(b.fd, buf.data(), buf.size());
+                break;
+            case FRAG_NONE:
+            case FRAG_SPLIT:
+                for (size_t i = 0, off = 0; ok && i < ends.size(); off = ends[i++]) {
+                    size_t len = ends[i] - off;
+                    size_t cut = o.frag == FRAG_SPLIT ? 1 + rng() % (len - 1) : len;
+                    ok = send_all(b.fd, buf.data() + off, cut) &&
+                         send_all(b.fd, buf.data() + off + cut, len - cut);
+                }
+                break;
+            case FRAG_RANDOM:
+                for (size_t off = 0; ok && off < buf.size(); ) {
+                    size_t n = std::min<size_t>(1 + rng() % 64, buf.size() - off);
+                    ok = send_all(b.fd, buf.data() + off, n);
+                    off += n;
+                }
+                break;
+            }
+            if (!ok) {
+                fprintf(stderr, "[BENCH] board %u: send failed\n", b.dev);
+                close(b.fd);
+                b.fd = -1;
+            }
+
+            b.next_ns += period;
+            if (period) wake = std::min(wake, b.next_ns);
+        }
+
+        uint64_t t = now_ns();
+        if (period && wake > t + 50000) {
+            uint64_t d = wake - t;
+            timespec ts{(time_t)(d / 1000000000ull), (long)(d % 1000000000ull)};
+            nanosleep(&ts, nullptr);
+        }
+    }
+out:
+    for (auto& b : boards) if (b.fd >= 0) close(b.fd);
+}
+
+/* ================= OBSERVERS ================= */
+static void live_observer(const Opts& o, Results& r, LiveState* live, uint64_t from)
+{
+    uint64_t idle_since = 0;
+
+    while (!r.stop) {
+        uint64_t before = from;
+        from = live->events.read_since(from, [&](uint64_t, const LiveEvent& e) {
+            uint64_t t = now_ns();
+            uint64_t k = o.proto == PROTO_V2
+                ? e.ev.seq
+                : (uint64_t)llround((e.ev.lat - 8.0) * 10000.0) +
+                  (uint64_t)llround((e.ev.lon - 68.0) * 10000.0) * LAT_SPAN;
+            if (k >= o.max_events) return;
+
+            uint64_t s = r.send_ns[k].load(std::memory_order_relaxed);
+            r.publish_order.push_back(k);
+            r.publish_lat.push_back(s && t > s ? t - s : 0);
+        });
+
+        if (from != before) {
+            idle_since = 0;
+        } else if (r.senders_done) {
+            /* drain: give the server a moment after the last send */
+            if (!idle_since) idle_since = now_ns();
+            else if (now_ns() - idle_since > 1000000000ull) r.stop = true;
+        }
+    }
+}
+
+static void capture_sink(Results& r, int udp)
+{
+    char buf[64];
+    while (!r.stop) {
+        ssize_t n = recv(udp, buf, sizeof(buf), 0);
+        if (n > 0) r.capture_ns.push_back(now_ns());
+    }
+}
+
+/* ================= REPORT ================= */
+static void report(const char* name, std::vector<uint64_t> v)
+{
+    if (v.empty()) {
+        printf("%-22s: no samples\n", name);
+        return;
+    }
+    std::sort(v.begin(), v.end());
+    auto pct = [&](double p) { return v[std::min(v.size() - 1, (size_t)(p * v.size()))] / 1000.0; };
+
+    printf("%-22s: n=%zu  p50=%.1fus  p99=%.1fus  p999=%.1fus  max=%.1fus\n",
+           name, v.size(), pct(0.50), pct(0.99), pct(0.999), v.back() / 1000.0);
+}
+
+static void usage(const char* p)
+{
+    fprintf(stderr,
+            "usage: %s [--host IP] [--port N] [--capture-port N] [--conns N]\n"
+            "          [--rate EV_PER_S_PER_CONN] [--burst N] [--duration S] [--threads N]\n"
+            "          [--frag none|coalesce|split|random] [--proto text|v2] [--pid SERVER_PID]\n", p);
+}
+
+int main(int argc, char* argv[])
+{
+    Opts o;
+
+    for (int i = 1; i < argc; i++) {
+        auto arg = [&](const char* name) { return !strcmp(argv[i], name) && i + 1 < argc; };
+
+        if      (arg("--host"))         o.host     = argv[++i];
+        else if (arg("--port"))         o.port     = atoi(argv[++i]);
+        else if (arg("--capture-port")) o.cap_port = atoi(argv[++i]);
+        else if (arg("--conns"))        o.conns    = atoi(argv[++i]);
+        else if (arg("--rate"))         o.rate     = atof(argv[++i]);
+        else if (arg("--burst"))        o.burst    = std::max(1, atoi(argv[++i]));
+        else if (arg("--duration"))     o.duration = atof(argv[++i]);
+        else if (arg("--threads"))      o.threads  = std::max(1, atoi(argv[++i]));
+        else if (arg("--pid"))          o.pid      = atoi(argv[++i]);
+        else if (arg("--frag")) {
+            const char* f = argv[++i];
+            o.frag = !strcmp(f, "coalesce") ? FRAG_COALESCE
+                   : !strcmp(f, "split")    ? FRAG_SPLIT
+                   : !strcmp(f, "random")   ? FRAG_RANDOM : FRAG_NONE;
+        }
+        else if (arg("--proto"))
+            o.proto = !strcmp(argv[++i], "v2") ? PROTO_V2 : PROTO_TEXT;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    LiveState* live = live_state_open();
+    if (!live) return 1;
+
+    Results r;
+    r.send_ns.reset(new std::atomic<uint64_t>[o.max_events]());
+    r.publish_order.reserve(1 << 20);
+    r.publish_lat.reserve(1 << 20);
+    r.capture_ns.reserve(1 << 20);
+
+    /* ---------- UDP SINK (stands in for the ESP32) ---------- */
+    int udp = socket(AF_INET, SOCK_DGRAM, 0);
+    int rcvbuf = 8 << 20;
+    setsockopt(udp, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    timeval tv{0, 100000};
+    setsockopt(udp, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    sockaddr_in cap{};
+    cap.sin_family = AF_INET;
+    cap.sin_port   = htons(o.cap_port);
+    cap.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(udp, (sockaddr*)&cap, sizeof(cap)) < 0) {
+        perror("[BENCH] bind capture port");
+        return 1;
+    }
+
+    /* ---------- BOARDS ---------- */
+    sockaddr_in srv{};
+    srv.sin_family = AF_INET;
+    srv.sin_port   = htons(o.port);
+    inet_pton(AF_INET, o.host, &srv.sin_addr);
+
+    std::vector<std::vector<SimBoard>> per_thread(o.threads);
+    uint64_t t0 = now_ns();
+    for (int i = 0; i < o.conns; i++) {
+        SimBoard b;
+        b.fd  = socket(AF_INET, SOCK_STREAM, 0);
+        b.dev = 0xB0000000u + i;
+        int on = 1;
+        setsockopt(b.fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        if (connect(b.fd, (sockaddr*)&srv, sizeof(srv)) < 0) {
+            perror("[BENCH] connect");
+            return 1;
+        }
+        /* spread the first ticks over one period */
+        b.next_ns = t0 + (o.rate > 0 ? (uint64_t)(1e9 * o.burst / o.rate) * i / o.conns : 0);
+        per_thread[i % o.threads].push_back(b);
+    }
+    printf("[BENCH] %d boards connected to %s:%d\n", o.conns, o.host, o.port);
+
+    /* ---------- RUN ---------- */
+    uint64_t from   = live->events.head.load();
+    double   cpu0   = proc_cpu_s(o.pid);
+    uint64_t start  = now_ns();
+    uint64_t end_ns = start + (uint64_t)(o.duration * 1e9);
+
+    std::thread obs(live_observer, std::cref(o), std::ref(r), live, from);
+    std::thread sink(capture_sink, std::ref(r), udp);
+
+    std::vector<std::thread> senders;
+    for (auto& boards : per_thread)
+        if (!boards.empty())
+            senders.emplace_back(sender_thread, std::cref(o), std::ref(r), boards, end_ns);
+    for (auto& t : senders) t.join();
+
+    double send_s = (now_ns() - start) / 1e9;
+    r.senders_done = true;
+    obs.join();
+    sink.join();
+    double cpu1 = proc_cpu_s(o.pid);
+
+    /* ---------- REPORT ---------- */
+    uint64_t sent = r.next_index.load();
+    std::vector<uint64_t> cap_lat;
+    for (size_t j = 0; j < r.capture_ns.size() && j < r.publish_order.size(); j++) {
+        uint64_t s = r.send_ns[r.publish_order[j]].load();
+        if (s && r.capture_ns[j] > s) cap_lat.push_back(r.capture_ns[j] - s);
+    }
+
+    printf("sent                  : %llu events in %.2fs (%.0f events/s offered)\n",
+           (unsigned long long)sent, send_s, sent / send_s);
+    printf("published             : %zu (%.0f events/s)\n",
+           r.publish_order.size(), r.publish_order.size() / send_s);
+    printf("captures              : %zu\n", r.capture_ns.size());
+    if (o.pid && sent)
+        printf("server cpu            : %.2fs, %.2f us/event\n",
+               cpu1 - cpu0, (cpu1 - cpu0) * 1e6 / std::max<size_t>(1, r.publish_order.size()));
+
+    report("send → live/API", r.publish_lat);
+    report("send → CAPTURE", cap_lat);
+
+    close(udp);
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+   Parse-throughput microbenchmark for the STM32 text protocol.
+
+   Feeds the same byte stream, cut into random recv()-sized pieces, to
+   the legacy "one recv == one message" getValue()/clean() path and to
+   LineFramer + parse_event(), and reports events/sec for each.
+
+   g++ -std=c++17 -O2 bench_parser.cpp -o bench_parser
+   ./bench_parser [events]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "event_parser.h"
+
+/* ================= LEGACY PATH ================= */
+static std::string clean(const std::string& s)
+{
+    std::string out = s;
+    out.erase(std::remove(out.begin(), out.end(), '\n'), out.end());
+    out.erase(std::remove(out.begin(), out.end(), '\r'), out.end());
+    return out;
+}
+
+static std::string getValue(const std::string& s, const std::string& k)
+{
+    size_t p = s.find(k + ":");
+    if (p == std::string::npos) return "NA";
+
+    p += k.size() + 1;
+    size_t e = s.find(",", p);
+    if (e == std::string::npos) e = s.size();
+
+    return s.substr(p, e - p);
+}
+
+/* ================= HELPERS ================= */
+static std::vector<std::string> make_lines(size_t n)
+{
+    std::mt19937 rng(42);
+    std::vector<std::string> lines;
+    lines.reserve(n);
+
+    char buf[128];
+    for (size_t i = 0; i < n; i++) {
+        if (rng() % 10 == 0) {
+            lines.emplace_back("EVENT:2G,LAT:NA,LON:NA,DATE:NA,TIME:NA\r\n");
+            continue;
+        }
+        snprintf(buf, sizeof(buf),
+                 "EVENT:2G,LAT:%.4f,LON:%.4f,DATE:%02u-%02u-2026,TIME:%02u:%02u:%02u\r\n",
+                 8.0 + (rng() % 290000) / 10000.0,
+                 68.0 + (rng() % 290000) / 10000.0,
+                 (unsigned)(1 + rng() % 28), (unsigned)(1 + rng() % 12),
+                 (unsigned)(rng() % 24), (unsigned)(rng() % 60), (unsigned)(rng() % 60));
+        lines.emplace_back(buf);
+    }
+    return lines;
+}
+
+/* recv() boundaries: whole lines, coalesced lines and split lines */
+static std::vector<std::string> make_chunks(const std::vector<std::string>& lines)
+{
+    std::string stream;
+    for (auto& l : lines) stream += l;
+
+    std::mt19937 rng(7);
+    std::vector<std::string> chunks;
+    for (size_t off = 0; off < stream.size(); ) {
+        size_t n = std::min<size_t>(1 + rng() % 255, stream.size() - off);
+        chunks.push_back(stream.substr(off, n));
+        off += n;
+    }
+    return chunks;
+}
+
+template <typename F>
+static double time_it(F&& f)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static volatile double sink;
+
+int main(int argc, char* argv[])
+{
+    size_t n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000000;
+
+    auto lines  = make_lines(n);
+    auto chunks = make_chunks(lines);
+
+    /* legacy: each message is handed over already framed, as the old
+       server assumed; it still gets the split streams wrong */
+    size_t legacy_2g = 0;
+    double t_legacy = time_it([&] {
+        for (auto& rx : lines) {
+            std::string event = clean(getValue(rx, "EVENT"));
+            std::string lat   = clean(getValue(rx, "LAT"));
+            std::string lon   = clean(getValue(rx, "LON"));
+            std::string date  = clean(getValue(rx, "DATE"));
+            std::string time  = clean(getValue(rx, "TIME"));
+            if (event == "2G") legacy_2g++;
+            sink = lat.size() + lon.size() + date.size() + time.size();
+        }
+    });
+
+    /* streaming: arbitrary recv() boundaries */
+    size_t stream_2g = 0;
+    double t_stream = time_it([&] {
+        LineFramer rx;
+        for (auto& c : chunks) {
+            size_t off = 0;
+            while (off < c.size()) {
+                char*  dst = rx.write_ptr();
+                size_t k   = std::min(rx.write_space(), c.size() - off);
+                memcpy(dst, c.data() + off, k);
+                rx.commit(k);
+                off += k;
+
+                std::string_view line;
+                while (rx.next_line(line)) {
+                    EventRecord ev;
+                    if (!parse_event(line, ev)) continue;
+                    if (ev.is("2G")) stream_2g++;
+                    sink = ev.lat + ev.lon;
+                }
+            }
+        }
+    });
+
+    printf("events            : %zu (%zu recv chunks)\n", n, chunks.size());
+    printf("getValue/clean    : %10.0f events/s  (%zu parsed)\n", n / t_legacy, legacy_2g);
+    printf("LineFramer+parse  : %10.0f events/s  (%zu parsed)\n", n / t_stream, stream_2g);
+    printf("speedup           : %.1fx\n", t_legacy / t_stream);
+    return stream_2g == n ? 0 : 1;
+}
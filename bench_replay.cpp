@@ -0,0 +1,632 @@
+/*
+   Record / replay benchmark for receiver's image path.
+
+   record: listens where receiver would (or on any port a camera or
+   camera_sim is pointed at) and saves every jpeg_hdr_t datagram with
+   its arrival time and sender to a file.
+
+   replay: plays a recording back to receiver as fast as the socket
+   allows (or at --rate datagrams/s) from --cameras simulated cameras,
+   each on its own socket. Every camera sends the whole recording
+   (--loops times) under fresh frame IDs; --interleave N switches
+   camera every N datagrams (0 = every frame). Loss, duplication and
+   reordering are injected on the way out from a seeded RNG, so a run
+   is reproducible. With --nack the cameras answer receiver's NACKs
+   from the recording, like the firmware does.
+
+   The report comes from receiver's own metrics (/dev/shm/rvims_metrics):
+   frames/s and completion ratio, reassembly latency percentiles
+   (rvims_frame_reassembly_seconds), kernel drops, and with --pid the
+   peak resident memory (VmHWM) of the receiver process.
+
+   ./receiver --thumb-workers 0 &
+   ./bench_replay record --port 9300 --out cam.rec --duration 30 &
+   ./camera_sim --port 9300 --frames 100 --interval 50 --no-nack
+   ./bench_replay replay --in cam.rec --cameras 8 --loops 5 --interleave 1 \
+                  --loss 2 --reorder 16 --nack --pid $(pidof receiver)
+
+   g++ -std=c++17 -O2 bench_replay.cpp -o bench_replay
+*/
+#include <arpa/inet.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "image_proto.h"
+#include "metrics.h"
+
+/* ================= RECORDING FORMAT ================= */
+/*
+   "RVUR" u32 version, then per datagram:
+       u32 t_us     arrival, microseconds after the first
+       u32 addr     sender IPv4, host order
+       u16 port     sender port
+       u16 len      datagram bytes that follow
+*/
+#define REPLAY_MAGIC    0x52555652u     // "RVUR"
+#define REPLAY_VERSION  1
+#define REPLAY_BATCH    64              // datagrams per sendmmsg()
+#define REPLAY_DGRAM_MAX 1500
+
+struct __attribute__((packed)) DgramHdr {
+    uint32_t t_us;
+    uint32_t addr;
+    uint16_t port;
+    uint16_t len;
+};
+
+struct Opts {
+    const char* host       = "127.0.0.1";
+    int         port       = 9200;
+    const char* file       = nullptr;
+    double      duration   = 0;         // record: seconds, 0 = until Ctrl-C
+    int         cameras    = 1;
+    int         loops      = 1;
+    int         interleave = 0;         // datagrams per camera turn, 0 = whole frames
+    double      rate       = 0;         // datagrams/s, 0 = line rate
+    double      loss       = 0;         // % of datagrams dropped
+    double      dup        = 0;         // % sent twice
+    int         reorder    = 0;         // shuffle window, datagrams
+    bool        nack       = false;
+    int         linger     = 4000;      // ms to wait for the last frames
+    unsigned    seed       = 1;
+    int         pid        = 0;         // receiver pid, for VmHWM
+};
+
+static uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* ================= RECORD ================= */
+static volatile sig_atomic_t stop_recording = 0;
+
+static void on_sigint(int) { stop_recording = 1; }
+
+static int record(const Opts& o)
+{
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+    int rcvbuf = 8 * 1024 * 1024;
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port        = htons(o.port);
+    if (bind(s, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("[REPLAY] bind");
+        return 1;
+    }
+
+    std::ofstream out(o.file, std::ios::binary);
+    if (!out) {
+        fprintf(stderr, "[REPLAY] cannot write %s\n", o.file);
+        return 1;
+    }
+    uint32_t head[2] = {REPLAY_MAGIC, REPLAY_VERSION};
+    out.write((const char*)head, sizeof(head));
+
+    signal(SIGINT, on_sigint);
+    signal(SIGTERM, on_sigint);
+    printf("[REPLAY] recording port %d to %s%s\n", o.port, o.file,
+           o.duration ? "" : " (Ctrl-C to stop)");
+
+    uint64_t first = 0, deadline = 0, n = 0, bytes = 0;
+    uint8_t buf[REPLAY_DGRAM_MAX];
+    while (!stop_recording) {
+        if (deadline && now_ns() >= deadline) break;
+
+        pollfd p = {s, POLLIN, 0};
+        if (poll(&p, 1, 100) <= 0) continue;
+
+        sockaddr_in from{};
+        socklen_t fl = sizeof(from);
+        ssize_t len = recvfrom(s, buf, sizeof(buf), 0, (sockaddr*)&from, &fl);
+        if (len < (ssize_t)sizeof(jpeg_hdr_t)) continue;
+
+        uint64_t t = now_ns();
+        if (!first) {
+            first = t;
+            if (o.duration) deadline = t + (uint64_t)(o.duration * 1e9);
+        }
+        DgramHdr h = {(uint32_t)((t - first) / 1000), ntohl(from.sin_addr.s_addr),
+                      ntohs(from.sin_port), (uint16_t)len};
+        out.write((const char*)&h, sizeof(h));
+        out.write((const char*)buf, len);
+        n++;
+        bytes += len;
+    }
+
+    printf("[REPLAY] recorded %llu datagrams (%llu KiB)\n",
+           (unsigned long long)n, (unsigned long long)bytes / 1024);
+    return 0;
+}
+
+/* ================= RECORDING → FRAMES ================= */
+struct Frame {
+    uint16_t                          total;
+    std::vector<std::vector<uint8_t>> chunks;       // data then parity, chunk order
+    std::vector<uint16_t>             ids;          // chunk_id of each
+};
+
+/*
+   Split the recording into frames per sender. Retransmissions and
+   duplicates in the recording are dropped: the replayer adds its own.
+*/
+static bool load_recording(const char* path, std::vector<Frame>& frames, size_t& senders)
+{
+    std::ifstream in(path, std::ios::binary);
+    uint32_t head[2];
+    if (!in.read((char*)head, sizeof(head)) || head[0] != REPLAY_MAGIC || head[1] != REPLAY_VERSION)
+        return false;
+
+    std::map<uint64_t, size_t> open;            // sender + frame_id -> frame
+    std::map<uint64_t, bool>   seen_senders;
+    std::vector<std::vector<bool>> have;
+
+    DgramHdr h;
+    std::vector<uint8_t> d;
+    while (in.read((char*)&h, sizeof(h))) {
+        d.resize(h.len);
+        if (!in.read((char*)d.data(), h.len)) break;
+        if (h.len < sizeof(jpeg_hdr_t)) continue;
+
+        jpeg_hdr_t hdr;
+        memcpy(&hdr, d.data(), sizeof(hdr));
+        if (!hdr.total_chunks) continue;
+
+        uint64_t sender = (uint64_t)h.addr << 16 | h.port;
+        uint64_t key = sender << 16 | hdr.frame_id;
+        seen_senders[sender] = true;
+
+        auto it = open.find(key);
+        bool fresh = it == open.end() || frames[it->second].total != hdr.total_chunks;
+        if (!fresh) {
+            // the frame ID came round again once the old frame was whole
+            const Frame& f = frames[it->second];
+            size_t data = std::count_if(f.ids.begin(), f.ids.end(),
+                                        [&](uint16_t c) { return c < f.total; });
+            fresh = data == f.total && hdr.chunk_id < hdr.total_chunks &&
+                    have[it->second][hdr.chunk_id];
+        }
+        if (fresh) {
+            open[key] = frames.size();
+            frames.push_back(Frame{hdr.total_chunks, {}, {}});
+            have.emplace_back(65536, false);
+            it = open.find(key);
+        }
+
+        if (have[it->second][hdr.chunk_id]) continue;
+        have[it->second][hdr.chunk_id] = true;
+        frames[it->second].chunks.push_back(d);
+        frames[it->second].ids.push_back(hdr.chunk_id);
+    }
+
+    for (Frame& f : frames) {
+        std::vector<size_t> order(f.ids.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return f.ids[a] < f.ids[b]; });
+
+        Frame sorted{f.total, {}, {}};
+        for (size_t i : order) {
+            sorted.chunks.push_back(std::move(f.chunks[i]));
+            sorted.ids.push_back(f.ids[i]);
+        }
+        f = std::move(sorted);
+    }
+    senders = seen_senders.size();
+    return true;
+}
+
+/* ================= METRICS SNAPSHOT ================= */
+struct Snapshot {
+    uint64_t counters[C_COUNT] = {};
+    int64_t  gauges[G_COUNT]   = {};
+    uint64_t reassembly[HIST_BUCKETS] = {};
+    uint64_t reassembly_n = 0;
+};
+
+static Snapshot snapshot(const MetricsShm* m)
+{
+    Snapshot s;
+    for (const MetricsShard& sh : m->shards) {
+        if (!sh.owner.load(std::memory_order_relaxed)) continue;
+        for (int i = 0; i < C_COUNT; i++) s.counters[i] += sh.counters[i].load(std::memory_order_relaxed);
+        for (int i = 0; i < G_COUNT; i++) s.gauges[i] += sh.gauges[i].load(std::memory_order_relaxed);
+        const HistShard& h = sh.hists[H_FRAME_REASSEMBLY];
+        for (int b = 0; b < HIST_BUCKETS; b++) s.reassembly[b] += h.buckets[b].load(std::memory_order_relaxed);
+        s.reassembly_n += h.count.load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+static uint64_t abandoned(const Snapshot& s)
+{
+    return s.counters[C_FRAMES_DROPPED] + s.counters[C_FRAMES_EXPIRED] + s.counters[C_FRAMES_EVICTED];
+}
+
+/* "VmHWM:" etc. from /proc/<pid>/status, KiB */
+static long proc_status_kb(int pid, const char* field)
+{
+    if (!pid) return 0;
+
+    std::ifstream f("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    while (std::getline(f, line))
+        if (!line.compare(0, strlen(field), field)) return atol(line.c_str() + strlen(field));
+    return 0;
+}
+
+/* ================= REPLAY ================= */
+struct Send {
+    uint16_t cam;
+    uint16_t frame_id;      // as sent
+    uint32_t frame;         // recording frame
+    uint16_t chunk;         // index into Frame::chunks
+};
+
+struct Camera {
+    int                                    sock;
+    uint16_t                               last_id = 0;
+    std::unordered_map<uint16_t, uint32_t> sent;    // frame_id -> recording frame
+};
+
+struct Stats {
+    uint64_t sent = 0, bytes = 0, dropped = 0, duped = 0;
+    uint64_t nacks = 0, resent = 0;
+};
+
+class Replayer {
+public:
+    Replayer(const Opts& o, const std::vector<Frame>& frames)
+        : o_(o), frames_(frames), rng_(o.seed * 7919), cams_(o.cameras)
+    {
+        srv_.sin_family = AF_INET;
+        srv_.sin_port   = htons(o.port);
+        inet_pton(AF_INET, o.host, &srv_.sin_addr);
+
+        for (Camera& c : cams_) {
+            c.sock = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+            int sndbuf = 4 * 1024 * 1024;
+            setsockopt(c.sock, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+            connect(c.sock, (sockaddr*)&srv_, sizeof(srv_));
+        }
+    }
+
+    /* the whole run, faults included, decided before the clock starts */
+    std::vector<Send> plan()
+    {
+        std::vector<std::vector<Send>> per_cam(cams_.size());
+        for (size_t c = 0; c < cams_.size(); c++) {
+            uint16_t frame_id = (uint16_t)(rng_() | 1);
+            for (int l = 0; l < o_.loops; l++)
+                for (uint32_t f = 0; f < frames_.size(); f++, frame_id++)
+                    for (uint16_t k = 0; k < frames_[f].chunks.size(); k++)
+                        per_cam[c].push_back(Send{(uint16_t)c, frame_id, f, k});
+        }
+
+        // round-robin turns: N datagrams, or one frame, per camera
+        std::vector<Send> all;
+        std::vector<size_t> pos(cams_.size(), 0);
+        for (bool more = true; more; ) {
+            more = false;
+            for (size_t c = 0; c < cams_.size(); c++) {
+                std::vector<Send>& q = per_cam[c];
+                size_t& p = pos[c];
+                if (p == q.size()) continue;
+                more = true;
+
+                size_t n = 0;
+                uint16_t frame_id = q[p].frame_id;
+                while (p < q.size() && (o_.interleave ? n < (size_t)o_.interleave
+                                                      : q[p].frame_id == frame_id)) {
+                    all.push_back(q[p++]);
+                    n++;
+                }
+            }
+        }
+        frames_sent_ = (uint64_t)frames_.size() * o_.loops * cams_.size();
+
+        std::vector<Send> out;
+        inject(all, out);
+        return out;
+    }
+
+    void run(const std::vector<Send>& sends, const MetricsShm* m, int64_t& peak_slabs)
+    {
+        uint64_t gap_ns = o_.rate > 0 ? (uint64_t)(1e9 / o_.rate) : 0;
+        uint64_t next = now_ns();
+
+        size_t batch = gap_ns ? 1 : REPLAY_BATCH;
+
+        for (size_t i = 0; i < sends.size(); ) {
+            size_t n = 1;
+            while (i + n < sends.size() && n < batch && sends[i + n].cam == sends[i].cam) n++;
+            if (gap_ns) {
+                while (now_ns() < next) {}
+                next += gap_ns;
+            }
+            send_batch(&sends[i], n);
+            i += n;
+
+            if ((i & 1023) < n) {
+                peak_slabs = std::max(peak_slabs, snapshot(m).gauges[G_FRAME_MEMORY]);
+                if (o_.nack) serve();
+            }
+        }
+    }
+
+    /* answer NACKs while the receiver finishes; done(): stop early */
+    template <typename F>
+    void linger(uint64_t until_ns, F&& done)
+    {
+        while (now_ns() < until_ns && !done()) {
+            if (o_.nack) serve();
+            usleep(2000);
+        }
+    }
+
+    uint64_t    frames_sent() const { return frames_sent_; }
+    const Stats& stats()      const { return st_; }
+
+private:
+    bool chance(double pct) { return pct > 0 && std::uniform_real_distribution<>(0, 100)(rng_) < pct; }
+
+    void inject(const std::vector<Send>& in, std::vector<Send>& out)
+    {
+        for (const Send& s : in) {
+            if (chance(o_.loss)) {
+                st_.dropped++;
+                continue;
+            }
+            out.push_back(s);
+            if (chance(o_.dup)) {
+                out.push_back(s);
+                st_.duped++;
+            }
+        }
+        if (o_.reorder > 1)
+            for (size_t i = 0; i < out.size(); i += o_.reorder)
+                std::shuffle(out.begin() + i, out.begin() + std::min(out.size(), i + o_.reorder), rng_);
+    }
+
+    /* n datagrams of one camera */
+    void send_batch(const Send* s, size_t n)
+    {
+        mmsghdr msgs[REPLAY_BATCH];
+        iovec   iov[REPLAY_BATCH][2];
+        jpeg_hdr_t hdrs[REPLAY_BATCH];
+
+        for (size_t i = 0; i < n; i++) {
+            const std::vector<uint8_t>& d = frames_[s[i].frame].chunks[s[i].chunk];
+            memcpy(&hdrs[i], d.data(), sizeof(jpeg_hdr_t));
+            hdrs[i].frame_id = s[i].frame_id;
+
+            Camera& c = cams_[s[i].cam];
+            if (c.last_id != s[i].frame_id) {
+                c.last_id = s[i].frame_id;
+                c.sent[s[i].frame_id] = s[i].frame;
+            }
+
+            iov[i][0] = {&hdrs[i], sizeof(jpeg_hdr_t)};
+            iov[i][1] = {(void*)(d.data() + sizeof(jpeg_hdr_t)), d.size() - sizeof(jpeg_hdr_t)};
+            msgs[i] = {};
+            msgs[i].msg_hdr.msg_iov    = iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 2;
+            st_.bytes += d.size();
+        }
+
+        int sock = cams_[s[0].cam].sock;
+        for (size_t done = 0; done < n; ) {
+            int r = sendmmsg(sock, msgs + done, (unsigned)(n - done), 0);
+            if (r < 0) {
+                if (errno != EAGAIN && errno != ENOBUFS) return;
+                pollfd p = {sock, POLLOUT, 0};      // send buffer full: wait for room
+                poll(&p, 1, 10);
+                continue;
+            }
+            done += r;
+            st_.sent += r;
+        }
+    }
+
+    /* resend what each NACK names, through the same fault injection */
+    void serve()
+    {
+        for (size_t c = 0; c < cams_.size(); c++) {
+            uint8_t buf[REPLAY_DGRAM_MAX];
+            ssize_t len;
+            while ((len = recv(cams_[c].sock, buf, sizeof(buf), 0)) >= (ssize_t)IMAGE_NACK_HDR_SIZE) {
+                image_nack_t nack;
+                memcpy(&nack, buf, std::min<size_t>(len, sizeof(nack)));
+                if (nack.magic != IMAGE_NACK_MAGIC) continue;
+                st_.nacks++;
+
+                auto it = cams_[c].sent.find(nack.frame_id);
+                if (it == cams_[c].sent.end()) continue;
+                const Frame& f = frames_[it->second];
+
+                std::vector<Send> want, out;
+                for (size_t i = 0; i < (len - IMAGE_NACK_HDR_SIZE) * 8; i++) {
+                    if (!image_nack_wants(&nack, (size_t)len, i)) continue;
+                    uint16_t chunk_id = (uint16_t)(nack.base_chunk + i);
+                    auto k = std::lower_bound(f.ids.begin(), f.ids.end(), chunk_id);
+                    if (k != f.ids.end() && *k == chunk_id)
+                        want.push_back(Send{(uint16_t)c, nack.frame_id, it->second,
+                                            (uint16_t)(k - f.ids.begin())});
+                }
+                inject(want, out);
+                st_.resent += out.size();
+                for (size_t i = 0; i < out.size(); i += REPLAY_BATCH)
+                    send_batch(&out[i], std::min<size_t>(REPLAY_BATCH, out.size() - i));
+            }
+        }
+    }
+
+    const Opts&               o_;
+    const std::vector<Frame>& frames_;
+    std::mt19937              rng_;
+    std::vector<Camera>       cams_;
+    sockaddr_in               srv_{};
+    Stats                     st_;
+    uint64_t                  frames_sent_ = 0;
+};
+
+/* ================= REPORT ================= */
+static void report_latency(const Snapshot& a, const Snapshot& b)
+{
+    uint64_t n = b.reassembly_n - a.reassembly_n;
+    if (!n) {
+        printf("[REPLAY] reassembly     : no samples\n");
+        return;
+    }
+
+    auto pct = [&](double p) {
+        uint64_t want = std::max<uint64_t>(1, (uint64_t)(p * n + 0.5)), seen = 0;
+        for (int i = 0; i < HIST_BUCKETS; i++) {
+            seen += b.reassembly[i] - a.reassembly[i];
+            if (seen >= want) return hist_bucket_upper(i) / 1e6;
+        }
+        return 0.0;
+    };
+    printf("[REPLAY] reassembly     : p50 %.2f ms  p99 %.2f ms  p999 %.2f ms  max %.2f ms\n",
+           pct(0.50), pct(0.99), pct(0.999), pct(1.0));
+}
+
+static int replay(const Opts& o)
+{
+    std::vector<Frame> frames;
+    size_t senders = 0;
+    if (!load_recording(o.file, frames, senders) || frames.empty()) {
+        fprintf(stderr, "[REPLAY] %s is not a recording (or has no frames)\n", o.file);
+        return 1;
+    }
+    size_t dgrams = 0, bytes = 0;
+    for (const Frame& f : frames)
+        for (const auto& c : f.chunks) {
+            dgrams++;
+            bytes += c.size();
+        }
+    printf("[REPLAY] recording      : %zu frames, %zu datagrams (%.1f MiB) from %zu sender%s\n",
+           frames.size(), dgrams, bytes / 1048576.0, senders, senders == 1 ? "" : "s");
+
+    MetricsShm* m = metrics_open();
+    if (!m) return 1;
+
+    Replayer r(o, frames);
+    std::vector<Send> sends = r.plan();
+    uint64_t total = r.frames_sent();
+
+    long rss0 = proc_status_kb(o.pid, "VmRSS:");
+    int64_t peak_slabs = 0;
+    Snapshot a = snapshot(m);
+
+    uint64_t t0 = now_ns();
+    r.run(sends, m, peak_slabs);
+    uint64_t t_sent = now_ns();
+
+    // wait until every frame is complete or given up on, noting when the last one finished
+    uint64_t done = 0, t_last = t_sent;
+    r.linger(t_sent + (uint64_t)o.linger * 1000000, [&] {
+        Snapshot s = snapshot(m);
+        peak_slabs = std::max(peak_slabs, s.gauges[G_FRAME_MEMORY]);
+        uint64_t d = s.counters[C_FRAMES_DONE] - a.counters[C_FRAMES_DONE];
+        if (d != done) {
+            done = d;
+            t_last = now_ns();
+        }
+        return d + abandoned(s) - abandoned(a) >= total;
+    });
+    Snapshot b = snapshot(m);
+    done = b.counters[C_FRAMES_DONE] - a.counters[C_FRAMES_DONE];
+
+    const Stats& st = r.stats();
+    double send_s = (t_sent - t0) / 1e9, run_s = (t_last - t0) / 1e9;
+    auto delta = [&](CounterId id) { return (unsigned long long)(b.counters[id] - a.counters[id]); };
+
+    printf("[REPLAY] sent           : %llu frames from %d camera%s, %llu datagrams in %.3f s "
+           "(%.0f dgram/s, %.1f MiB/s)\n",
+           (unsigned long long)total, o.cameras, o.cameras == 1 ? "" : "s",
+           (unsigned long long)st.sent, send_s, st.sent / send_s, st.bytes / 1048576.0 / send_s);
+    printf("[REPLAY] faults         : %llu dropped, %llu duplicated, reorder window %d, interleave %d\n",
+           (unsigned long long)st.dropped, (unsigned long long)st.duped, o.reorder, o.interleave);
+    printf("[REPLAY] completed      : %llu / %llu frames (%.1f%%), %.0f frames/s\n",
+           (unsigned long long)done, (unsigned long long)total, 100.0 * done / total,
+           run_s > 0 ? done / run_s : 0.0);
+    printf("[REPLAY] abandoned      : %llu dropped, %llu expired, %llu evicted\n",
+           delta(C_FRAMES_DROPPED), delta(C_FRAMES_EXPIRED), delta(C_FRAMES_EVICTED));
+    printf("[REPLAY] recovery       : %llu NACKs (%llu chunks resent), %llu chunks rebuilt by FEC\n",
+           (unsigned long long)st.nacks, (unsigned long long)st.resent, delta(C_CHUNKS_FEC_RECOVERED));
+    printf("[REPLAY] kernel drops   : %llu\n", delta(C_UDP_KERNEL_DROPS));
+    report_latency(a, b);
+    printf("[REPLAY] frame slabs    : peak %.1f MiB\n", peak_slabs / 1048576.0);
+    if (o.pid)
+        printf("[REPLAY] receiver memory: VmHWM %.1f MiB (VmRSS %.1f MiB before, %.1f MiB after)\n",
+               proc_status_kb(o.pid, "VmHWM:") / 1024.0, rss0 / 1024.0,
+               proc_status_kb(o.pid, "VmRSS:") / 1024.0);
+    return 0;
+}
+
+static void usage(const char* p)
+{
+    fprintf(stderr,
+            "usage: %s record --out FILE [--port N] [--duration S]\n"
+            "       %s replay --in FILE [--host IP] [--port N] [--cameras N] [--loops N]\n"
+            "              [--interleave N] [--rate DGRAM_PER_S] [--loss PCT] [--dup PCT]\n"
+            "              [--reorder WINDOW] [--nack] [--linger MS] [--seed N] [--pid RECEIVER_PID]\n",
+            p, p);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || (strcmp(argv[1], "record") && strcmp(argv[1], "replay"))) {
+        usage(argv[0]);
+        return 1;
+    }
+    bool rec = !strcmp(argv[1], "record");
+    Opts o;
+
+    for (int i = 2; i < argc; i++) {
+        auto arg = [&](const char* name) { return !strcmp(argv[i], name) && i + 1 < argc; };
+
+        if      (arg("--out") && rec)   o.file       = argv[++i];
+        else if (arg("--in") && !rec)   o.file       = argv[++i];
+        else if (arg("--host"))         o.host       = argv[++i];
+        else if (arg("--port"))         o.port       = atoi(argv[++i]);
+        else if (arg("--duration"))     o.duration   = atof(argv[++i]);
+        else if (arg("--cameras"))      o.cameras    = std::max(1, std::min(atoi(argv[++i]), 1024));
+        else if (arg("--loops"))        o.loops      = std::max(1, atoi(argv[++i]));
+        else if (arg("--interleave"))   o.interleave = std::max(0, atoi(argv[++i]));
+        else if (arg("--rate"))         o.rate       = atof(argv[++i]);
+        else if (arg("--loss"))         o.loss       = atof(argv[++i]);
+        else if (arg("--dup"))          o.dup        = atof(argv[++i]);
+        else if (arg("--reorder"))      o.reorder    = atoi(argv[++i]);
+        else if (arg("--linger"))       o.linger     = atoi(argv[++i]);
+        else if (arg("--seed"))         o.seed       = atoi(argv[++i]);
+        else if (arg("--pid"))          o.pid        = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--nack")) o.nack = true;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!o.file) {
+        usage(argv[0]);
+        return 1;
+    }
+    return rec ? record(o) : replay(o);
+}
@@ -0,0 +1,311 @@
+/*
+   Linux stand-in for the ESP32-CAM image sender (WiFi_SendJPEG).
+
+   Sends JPEG frames to receiver as jpeg_hdr_t chunks from one persistent
+   socket, optionally followed per block by Reed-Solomon repair chunks
+   (--fec PCT), keeps the last IMG_CACHE_FRAMES frames for
+   retransmission and answers NACKs exactly like the firmware does.
+   Loss, duplication and reordering are injected on the way out
+   (retransmissions included), so recovery can be exercised on localhost:
+
+   ./receiver &
+   ./camera_sim --frames 200 --loss 5 --reorder 8 --verify
+   ./camera_sim --frames 200 --loss 5 --fec 25 --no-nack --verify
+
+   Completion is read back from the shared-memory live state (the image
+   ring receiver publishes to); --verify also compares the stored images
+   (image_store.h), which requires running from receiver's working
+   directory.
+
+   g++ -std=c++17 -O2 camera_sim.cpp -o camera_sim
+*/
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "image_proto.h"
+#include "image_fec.h"
+#include "image_store.h"
+#include "live_state.h"
+
+/* ================= CONFIG ================= */
+#define IMG_CACHE_FRAMES    4       // same as app_wifi_task.c
+
+struct Opts {
+    const char* host      = "127.0.0.1";
+    int         port      = 9200;
+    const char* file      = nullptr;    // JPEG to send, else synthetic
+    int         size      = 40000;      // synthetic frame size, bytes
+    int         frames    = 100;
+    int         interval  = 200;        // ms between frames
+    double      loss      = 0;          // % of chunk datagrams dropped
+    double      dup       = 0;          // % sent twice
+    int         reorder   = 0;          // shuffle window, chunks
+    int         fec       = 0;          // repair overhead, % (0 = off)
+    int         fec_block = 16;         // data chunks per FEC block
+    bool        nack      = true;
+    int         linger    = 1500;       // ms to keep answering NACKs at the end
+    bool        verify    = false;
+    unsigned    seed      = 1;
+    uint32_t    event     = 0;          // event ID of the first frame (+1 each), 0 = none
+};
+
+struct Stats {
+    uint64_t chunks = 0, parity = 0, dropped = 0, duped = 0;
+    uint64_t nacks = 0, resent = 0, nack_miss = 0;
+};
+
+static uint64_t now_ms()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+struct CachedFrame {
+    uint16_t             frame_id = 0;
+    uint32_t             event_id = 0;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> parity;        // m chunks per block, block order
+};
+
+class CameraSim {
+public:
+    CameraSim(const Opts& o) : o_(o), rng_(o.seed), cache_(IMG_CACHE_FRAMES)
+    {
+        image_gf_init(&gf_);
+        fec_m_ = o.fec ? image_fec_parity(o.fec_block, o.fec) : 0;
+        sock_ = socket(AF_INET, SOCK_DGRAM, 0);
+        srv_.sin_family = AF_INET;
+        srv_.sin_port   = htons(o.port);
+        inet_pton(AF_INET, o.host, &srv_.sin_addr);
+    }
+
+    void send_frame(uint16_t frame_id, uint32_t event_id, const std::vector<uint8_t>& data)
+    {
+        CachedFrame& c = cache_[frame_id % IMG_CACHE_FRAMES];
+        c.frame_id = frame_id;
+        c.event_id = event_id;
+        c.data     = data;
+
+        uint16_t total = (data.size() + IMAGE_MAX_PAYLOAD - 1) / IMAGE_MAX_PAYLOAD;
+        std::vector<uint16_t> order;
+
+        // data chunks, each block followed by its repair chunks
+        unsigned k = o_.fec_block, blocks = fec_m_ ? (total + k - 1) / k : 0;
+        c.parity.resize((size_t)blocks * fec_m_ * IMAGE_MAX_PAYLOAD);
+        for (unsigned b = 0; b < std::max(blocks, 1u); b++) {
+            unsigned first = b * k, kb = fec_m_ ? std::min<unsigned>(k, total - first) : total;
+            for (unsigned j = 0; j < kb; j++) order.push_back(first + j);
+            if (!fec_m_) break;
+
+            image_fec_encode_block(&gf_, data.data(), data.size(), first, kb, fec_m_,
+                                   c.parity.data() + (size_t)b * fec_m_ * IMAGE_MAX_PAYLOAD);
+            for (unsigned r = 0; r < fec_m_; r++) order.push_back(total + b * fec_m_ + r);
+        }
+        if (o_.reorder > 1)
+            for (size_t i = 0; i < order.size(); i += o_.reorder)
+                std::shuffle(order.begin() + i,
+                             order.begin() + std::min(order.size(), i + o_.reorder), rng_);
+
+        for (uint16_t id : order) send_chunk(c, id, total);
+    }
+
+    /* answer NACKs until deadline */
+    void serve(uint64_t deadline)
+    {
+        for (uint64_t t; (t = now_ms()) < deadline; ) {
+            pollfd p{sock_, POLLIN, 0};
+            if (poll(&p, 1, (int)(deadline - t)) <= 0) continue;
+
+            image_nack_t nack;
+            ssize_t len = recv(sock_, &nack, sizeof(nack), 0);
+            if (len < (ssize_t)IMAGE_NACK_HDR_SIZE || nack.magic != IMAGE_NACK_MAGIC) continue;
+            st.nacks++;
+            if (!o_.nack) continue;
+
+            CachedFrame& c = cache_[nack.frame_id % IMG_CACHE_FRAMES];
+            if (c.frame_id != nack.frame_id || c.data.empty()) {
+                st.nack_miss++;
+                continue;
+            }
+            uint16_t total = (c.data.size() + IMAGE_MAX_PAYLOAD - 1) / IMAGE_MAX_PAYLOAD;
+            for (size_t i = 0; i < IMAGE_NACK_MAX_BITMAP * 8; i++)
+                if (image_nack_wants(&nack, len, i)) {
+                    send_chunk(c, nack.base_chunk + i, total);
+                    st.resent++;
+                }
+        }
+    }
+
+    Stats st;
+
+private:
+    void send_chunk(const CachedFrame& c, uint16_t k, uint16_t total)
+    {
+        std::uniform_real_distribution<double> pct(0, 100);
+
+        uint8_t packet[sizeof(jpeg_hdr_t) + sizeof(image_fec_hdr_t) + IMAGE_MAX_PAYLOAD];
+        jpeg_hdr_t* hdr = (jpeg_hdr_t*)packet;
+        hdr->frame_id     = c.frame_id;
+        hdr->chunk_id     = k;
+        hdr->total_chunks = total;
+        hdr->event_id     = c.event_id;
+
+        size_t chunk;
+        if (k < total) {
+            size_t offset = (size_t)k * IMAGE_MAX_PAYLOAD;
+            chunk = std::min<size_t>(IMAGE_MAX_PAYLOAD, c.data.size() - offset);
+            memcpy(packet + sizeof(jpeg_hdr_t), c.data.data() + offset, chunk);
+            st.chunks++;
+        } else {
+            image_fec_hdr_t fh;
+            fh.block_k  = o_.fec_block;
+            fh.parity_m = fec_m_;
+            fh.last_len = c.data.size() - (size_t)(total - 1) * IMAGE_MAX_PAYLOAD;
+            memcpy(packet + sizeof(jpeg_hdr_t), &fh, sizeof(fh));
+            memcpy(packet + sizeof(jpeg_hdr_t) + sizeof(fh),
+                   c.parity.data() + (size_t)(k - total) * IMAGE_MAX_PAYLOAD, IMAGE_MAX_PAYLOAD);
+            chunk = sizeof(fh) + IMAGE_MAX_PAYLOAD;
+            st.parity++;
+        }
+        hdr->payload_size = chunk;
+
+        if (pct(rng_) < o_.loss) {
+            st.dropped++;
+            return;
+        }
+        int copies = pct(rng_) < o_.dup ? 2 : 1;
+        st.duped += copies - 1;
+        while (copies--)
+            sendto(sock_, packet, sizeof(jpeg_hdr_t) + chunk, 0, (sockaddr*)&srv_, sizeof(srv_));
+    }
+
+    const Opts&              o_;
+    std::mt19937             rng_;
+    image_gf_t               gf_;
+    unsigned                 fec_m_;
+    int                      sock_;
+    sockaddr_in              srv_{};
+    std::vector<CachedFrame> cache_;
+};
+
+static std::vector<uint8_t> make_frame(const Opts& o, std::mt19937& rng)
+{
+    if (o.file) {
+        std::ifstream f(o.file, std::ios::binary);
+        return std::vector<uint8_t>((std::istreambuf_iterator<char>(f)),
+                                    std::istreambuf_iterator<char>());
+    }
+    std::vector<uint8_t> v(std::max(o.size, 4));
+    for (auto& b : v) b = (uint8_t)rng();
+    v[0] = 0xFF; v[1] = 0xD8;                       // SOI
+    v[v.size() - 2] = 0xFF; v[v.size() - 1] = 0xD9; // EOI
+    return v;
+}
+
+static void usage(const char* p)
+{
+    fprintf(stderr,
+            "usage: %s [--host IP] [--port N] [--file JPEG | --size BYTES] [--frames N]\n"
+            "          [--interval MS] [--loss PCT] [--dup PCT] [--reorder WINDOW]\n"
+            "          [--fec PCT] [--fec-block K] [--no-nack] [--linger MS] [--verify]\n"
+            "          [--event FIRST_ID] [--seed N]\n", p);
+}
+
+int main(int argc, char* argv[])
+{
+    Opts o;
+
+    for (int i = 1; i < argc; i++) {
+        auto arg = [&](const char* name) { return !strcmp(argv[i], name) && i + 1 < argc; };
+
+        if      (arg("--host"))     o.host     = argv[++i];
+        else if (arg("--port"))     o.port     = atoi(argv[++i]);
+        else if (arg("--file"))     o.file     = argv[++i];
+        else if (arg("--size"))     o.size     = atoi(argv[++i]);
+        else if (arg("--frames"))   o.frames   = atoi(argv[++i]);
+        else if (arg("--interval")) o.interval = atoi(argv[++i]);
+        else if (arg("--loss"))     o.loss     = atof(argv[++i]);
+        else if (arg("--dup"))      o.dup      = atof(argv[++i]);
+        else if (arg("--reorder"))  o.reorder  = atoi(argv[++i]);
+        else if (arg("--fec"))      o.fec      = atoi(argv[++i]);
+        else if (arg("--fec-block"))
+            o.fec_block = std::max(1, std::min(atoi(argv[++i]), IMAGE_FEC_MAX_K));
+        else if (arg("--linger"))   o.linger   = atoi(argv[++i]);
+        else if (arg("--seed"))     o.seed     = atoi(argv[++i]);
+        else if (arg("--event"))    o.event    = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(argv[i], "--no-nack")) o.nack   = false;
+        else if (!strcmp(argv[i], "--verify"))  o.verify = true;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    LiveState* live = live_state_open();
+    if (!live) return 1;
+    uint64_t from = live->images.head.load();
+
+    CameraSim cam(o);
+    std::mt19937 rng(o.seed * 7919);
+    std::map<uint16_t, std::vector<uint8_t>> sent;
+    std::vector<bool> ours(65536);
+
+    uint16_t frame_id = (uint16_t)(rng() | 1), first_id = frame_id;
+    for (int n = 0; n < o.frames; n++, frame_id++) {
+        std::vector<uint8_t> data = make_frame(o, rng);
+        if (data.empty()) {
+            fprintf(stderr, "[CAM] cannot read %s\n", o.file);
+            return 1;
+        }
+        uint64_t next = now_ms() + o.interval;
+        cam.send_frame(frame_id, o.event ? o.event + n : 0, data);
+        ours[frame_id] = true;
+        if (o.verify) sent[frame_id] = std::move(data);
+        cam.serve(next);
+    }
+    cam.serve(now_ms() + o.linger);
+
+    /* ---------- REPORT ---------- */
+    int done = 0, bad = 0;
+    live->images.read_since(from, [&](uint64_t, const LiveImage& im) {
+        if (!ours[im.frame_id]) return;
+        done++;
+        if (!o.verify) return;
+        auto it = sent.find(im.frame_id);
+        uint32_t event_id = o.event ? o.event + (uint16_t)(im.frame_id - first_id) : 0;
+        char day[16];
+        unsigned n;
+        ImageRecord r;
+        std::string got;
+        if (it == sent.end() || sscanf(im.path, "%10[0-9-]/%u.jpg", day, &n) != 2 ||
+            !image_store_record(IMAGE_STORE_DIR, day, n, r) ||
+            !image_store_read(IMAGE_STORE_DIR, day, r, got) ||
+            im.event_id != event_id || r.event_id != event_id ||
+            got.size() != it->second.size() || memcmp(got.data(), it->second.data(), got.size()))
+            bad++;
+    });
+
+    const Stats& s = cam.st;
+    printf("[CAM] frames sent     : %d\n", o.frames);
+    printf("[CAM] frames complete : %d (%.1f%%)%s\n", done, 100.0 * done / o.frames,
+           o.verify ? (bad ? "  CONTENT MISMATCH" : "  content verified") : "");
+    printf("[CAM] chunks          : %llu data + %llu parity sent, %llu dropped, %llu duplicated\n",
+           (unsigned long long)s.chunks, (unsigned long long)s.parity,
+           (unsigned long long)s.dropped, (unsigned long long)s.duped);
+    printf("[CAM] NACKs           : %llu received, %llu chunks resent, %llu for evicted frames\n",
+           (unsigned long long)s.nacks, (unsigned long long)s.resent, (unsigned long long)s.nack_miss);
+    return bad ? 1 : 0;
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "event_journal.h"
+#include "image_store.h"
+
+/*
+   Event → image join for /api/events/{id}.
+
+   Every stored image carries the journal ID of the event whose CAPTURE
+   command took it (ImageRecord::event_id). This index maps that ID to
+   the image's place in the store; the event itself is a single
+   journal_lookup() away, so a request costs one hash probe and one
+   pread instead of a time-window match on the client.
+
+   It also keeps the newest image of each camera frame ID, which is what
+   the pre-store URLs (/images/image_N/image_N.jpg) name.
+
+   Built from every day's image index at startup, then follows the
+   newest day. If an event has several images, the latest one wins.
+*/
+
+struct CaptureRef {
+    char     day[12];       // store partition, "YYYY-MM-DD"
+    uint32_t n;             // slot in the day's index
+    uint32_t time;          // capture, UTC epoch seconds
+    uint32_t device;        // camera IPv4 address, host order
+};
+
+class SharedCaptureIndex {
+public:
+    explicit SharedCaptureIndex(std::string root = IMAGE_STORE_DIR) : root_(std::move(root)) {}
+
+    /* pull every image stored since the last call */
+    size_t catch_up()
+    {
+        /* read outside the lock, publish in one short critical section */
+        std::vector<std::pair<uint32_t, CaptureRef>> fresh;
+        std::vector<std::pair<uint16_t, CaptureRef>> frames;
+
+        for (const std::string& day : image_store_days(root_)) {
+            if (day < day_) continue;
+            uint32_t from = day == day_ ? next_ : 0;
+
+            std::vector<ImageRecord> recs = image_store_index(root_, day, from);
+            for (uint32_t i = 0; i < recs.size(); i++) {
+                CaptureRef c{};
+                snprintf(c.day, sizeof(c.day), "%s", day.c_str());
+                c.n      = from + i;
+                c.time   = recs[i].time;
+                c.device = recs[i].device;
+                frames.emplace_back(recs[i].frame_id, c);
+                if (recs[i].event_id) fresh.emplace_back(recs[i].event_id, c);
+            }
+            day_  = day;
+            next_ = from + (uint32_t)recs.size();
+        }
+        if (frames.empty()) return 0;
+
+        std::unique_lock<std::shared_mutex> lk(mu_);
+        for (auto& f : frames) by_frame_[f.first] = f.second;
+        for (auto& f : fresh) by_event_[f.first] = f.second;
+        version_ += fresh.size();
+        return fresh.size();
+    }
+
+    bool find(uint32_t event_id, CaptureRef& out) const
+    {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        auto it = by_event_.find(event_id);
+        if (it == by_event_.end()) return false;
+        out = it->second;
+        return true;
+    }
+
+    /* newest stored image of a camera frame ID */
+    bool find_frame(uint16_t frame_id, CaptureRef& out) const
+    {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        auto it = by_frame_.find(frame_id);
+        if (it == by_frame_.end()) return false;
+        out = it->second;
+        return true;
+    }
+
+    size_t size() const
+    {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        return by_event_.size();
+    }
+
+    /* event images indexed so far, including ones that replaced another */
+    uint64_t version() const
+    {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        return version_;
+    }
+
+private:
+    std::string                              root_;
+    std::string                              day_;      // newest day seen (catch_up thread only)
+    uint32_t                                 next_ = 0; // its next unread slot
+    mutable std::shared_mutex                mu_;
+    std::unordered_map<uint32_t, CaptureRef> by_event_;
+    std::unordered_map<uint16_t, CaptureRef> by_frame_;
+    uint64_t                                 version_ = 0;
+};
+
+/* ================= JSON VIEW ================= */
+/* one event and its image (null if none was stored) */
+inline std::string capture_json(uint64_t id, const EventRecord& ev, const CaptureRef* img)
+{
+    char lat[32] = "null", lon[32] = "null";
+    if (ev.has_fix) {
+        snprintf(lat, sizeof(lat), "%.7f", ev.lat);
+        snprintf(lon, sizeof(lon), "%.7f", ev.lon);
+    }
+
+    char image[160] = "null";
+    if (img)
+        snprintf(image, sizeof(image),
+                 "{\"url\":\"/images/%s/%u.jpg\",\"time\":%u,\"camera\":\"%u.%u.%u.%u\"}",
+                 img->day, img->n, img->time,
+                 img->device >> 24, (img->device >> 16) & 0xFF,
+                 (img->device >> 8) & 0xFF, img->device & 0xFF);
+
+    char buf[384];
+    snprintf(buf, sizeof(buf),
+             "{\"id\":%llu,\"event\":\"%.8s\",\"time\":%u,\"lat\":%s,\"lon\":%s,"
+             "\"device\":%u,\"peak_mg\":%u,\"image\":%s}\n",
+             (unsigned long long)id, ev.event, ev.epoch ? ev.epoch : ev.rx_time, lat, lon,
+             ev.device_id, (unsigned)ev.peak_mg, image);
+    return buf;
+}
@@ -0,0 +1,602 @@
+#pragma once
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <thread>
+#include <chrono>
+
+#include "httplib.h"   // cpp-httplib header
+#include "live_state.h"
+#include "event_index.h"
+#include "image_store.h"
+#include "capture_index.h"
+#include "image_thumb.h"
+#include "asset_cache.h"
+#include "event_stream.h"
+#include "metrics.h"
+
+#define INDEX_POLL_MS   200     // journal tail interval for /api/events
+#define EVENTS_LIMIT    1000    // default / max rows per /api/events reply
+#define EVENTS_LIMIT_MAX 100000
+
+#define IMAGE_CACHE_CONTROL "public, max-age=31536000, immutable"   // <day>/<n>.jpg never changes
+
+#define DASH_PORT           8080
+#define DASH_PAYLOAD_MAX    (64 * 1024)     // request bodies; every route is a GET
+#define DASH_STREAMS_MAX    16              // open /api/stream subscribers
+
+// Utility: read file into string
+inline std::string read_file(const std::string &path, bool binary = false)
+{
+    std::ios::openmode mode = std::ios::in;
+    if (binary) mode |= std::ios::binary;
+
+    std::ifstream file(path, mode);
+    if (!file.is_open()) return "";
+
+    return std::string(
+        (std::istreambuf_iterator<char>(file)),
+        std::istreambuf_iterator<char>()
+    );
+}
+
+/* a web/ file from the asset cache: best encoding, 304 on a matching ETag */
+inline void serve_asset(const AssetCache& assets, const std::string& path,
+                        const httplib::Request &req, httplib::Response &res)
+{
+    std::shared_ptr<const AssetMap> snap = assets.snapshot();
+    auto it = snap->find(path);
+    if (it == snap->end()) {
+        res.status = 404;
+        res.set_content("Not found", "text/plain");
+        return;
+    }
+    const Asset& a = it->second;
+    AssetEncoding enc = asset_pick(a, req.get_header_value("Accept-Encoding"));
+
+    res.set_header("ETag", a.etag[enc]);
+    res.set_header("Cache-Control", a.cache_control);
+    if (!a.body[ENC_GZIP].empty() || !a.body[ENC_BROTLI].empty())
+        res.set_header("Vary", "Accept-Encoding");
+
+    if (asset_not_modified(req.get_header_value("If-None-Match"), a.etag[enc])) {
+        res.status = 304;
+        return;
+    }
+    if (enc != ENC_IDENTITY) res.set_header("Content-Encoding", enc == ENC_GZIP ? "gzip" : "br");
+
+    // straight from the snapshot (or the compiled-in array), which the provider keeps alive
+    std::string_view body = a.body[enc];
+    res.set_content_provider(body.size(), a.mime,
+        [snap, body](size_t offset, size_t length, httplib::DataSink &sink) {
+            return sink.write(body.data() + offset, length);
+        });
+}
+
+/* RFC 9110 IMF-fixdate */
+inline std::string http_date(time_t t)
+{
+    tm g;
+    gmtime_r(&t, &g);
+    char buf[40];
+    strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &g);
+    return buf;
+}
+
+inline time_t http_date_parse(const std::string& s)
+{
+    tm g{};
+    const char* end = strptime(s.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &g);
+    return end && !*end ? timegm(&g) : (time_t)-1;
+}
+
+/* conditional GET: If-None-Match wins over If-Modified-Since */
+inline bool not_modified(const httplib::Request &req, const std::string& etag, time_t mtime)
+{
+    if (req.has_header("If-None-Match"))
+        return asset_not_modified(req.get_header_value("If-None-Match"), etag);
+    if (!req.has_header("If-Modified-Since")) return false;
+    time_t since = http_date_parse(req.get_header_value("If-Modified-Since"));
+    return since != (time_t)-1 && mtime <= since;
+}
+
+/*
+   Versioned API responses. Every API resource has a counter that only
+   grows (a live ring head, the next journal ID, event images indexed)
+   and its ETag is built from it, so a client polling with If-None-Match
+   gets a 304 until something is added. Take the version before building
+   the body: the body may then be newer than its tag, never older.
+   X-Resource-Version is what to pass as ?since= next time.
+*/
+inline bool api_not_modified(const httplib::Request &req, httplib::Response &res,
+                             uint32_t epoch, uint64_t version)
+{
+    char tag[48];
+    snprintf(tag, sizeof(tag), "\"%x-%llu\"", epoch, (unsigned long long)version);
+    res.set_header("ETag", tag);
+    res.set_header("Cache-Control", "no-cache");
+    res.set_header("X-Resource-Version", std::to_string(version));
+    if (!asset_not_modified(req.get_header_value("If-None-Match"), tag)) return false;
+    res.status = 304;
+    return true;
+}
+
+/* --json-files: the file's mtime stands in for a version */
+inline uint64_t file_version(const char* path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+    return (uint64_t)st.st_mtim.tv_sec * 1000000000ull + (uint64_t)st.st_mtim.tv_nsec;
+}
+
+/*
+   JPEG bytes straight out of a mapping (pack or loose file): httplib
+   writes the slice to the socket and answers Range requests from it.
+*/
+inline void serve_mapped(std::shared_ptr<const ImageMapping> m, const uint8_t* jpeg, size_t len,
+                         httplib::Response &res)
+{
+    res.set_header("Accept-Ranges", "bytes");
+    res.set_content_provider(len, "image/jpeg",
+        [m, jpeg](size_t offset, size_t length, httplib::DataSink &sink) {
+            return sink.write((const char*)jpeg + offset, length);
+        });
+}
+
+/*
+   A stored image: full size from the mapped pack, or a thumbnail
+   (denom >= 0, see image_thumb.h). cache_control differs for URLs whose
+   target can change.
+*/
+inline void serve_image(ImagePackCache& packs, const std::string& day, uint32_t n,
+                        const ImageRecord& r, int denom, const char* cache_control,
+                        const httplib::Request &req, httplib::Response &res)
+{
+    char etag[48];
+    if (denom < 0) snprintf(etag, sizeof(etag), "\"%08x-%x\"", r.crc32, r.len);
+    else           snprintf(etag, sizeof(etag), "\"%08x-%x-t%d\"", r.crc32, r.len, denom);
+
+    res.set_header("ETag", etag);
+    res.set_header("Last-Modified", http_date(r.time));
+    res.set_header("Cache-Control", cache_control);
+    if (not_modified(req, etag, r.time)) {
+        res.status = 304;
+        return;
+    }
+
+    std::string thumb;
+    if (denom >= 0 && thumb_read(IMAGE_STORE_DIR, day, n, (unsigned)denom, thumb)) {
+        res.set_content(thumb, "image/jpeg");
+        return;
+    }
+
+    std::shared_ptr<const ImageMapping> m = packs.map(day, r);
+    if (!m) {
+        res.status = 404;
+        res.set_content("Image not found", "text/plain");
+        return;
+    }
+    const uint8_t* jpeg = m->base + r.offset;
+
+    // thumbnail not made yet (or stored before thumbnails): scale it now
+    if (denom >= 0 && jpeg_scale(jpeg, r.len, (unsigned)denom, thumb)) {
+        res.set_content(thumb, "image/jpeg");
+        return;
+    }
+    serve_mapped(m, jpeg, r.len, res);
+}
+
+/* ================= SERVER SETTINGS ================= */
+/*
+   httplib serves a connection on one pool thread for as long as it is
+   kept alive, so the pool size bounds how many viewers are served at
+   once and the keep-alive limits decide how long an idle viewer keeps
+   one. An open /api/stream holds its thread until the page closes, so
+   at most `streams` are accepted (more get a 503 and the page polls
+   instead) and the pool is that many threads larger than `threads`.
+   0 leaves httplib's defaults. Compare settings with bench_http.
+*/
+struct DashboardOptions {
+    int    port           = DASH_PORT;
+    size_t threads        = 0;      // for everything but streams; 0 = CPPHTTPLIB_THREAD_POOL_COUNT
+    size_t streams        = DASH_STREAMS_MAX;
+    size_t keep_alive_max = 0;      // requests per connection
+    time_t keep_alive_s   = 0;      // idle seconds before a kept-alive connection is closed
+    time_t read_timeout_s = 0;
+    size_t payload_max    = DASH_PAYLOAD_MAX;
+    const char* web_dir   = nullptr;    // serve this tree from disk instead (see asset_cache.h)
+};
+
+inline void dashboard_configure(httplib::Server& svr, const DashboardOptions& o)
+{
+    size_t n = (o.threads ? o.threads : CPPHTTPLIB_THREAD_POOL_COUNT) + o.streams;
+    svr.new_task_queue = [n] { return new httplib::ThreadPool(n); };
+    if (o.keep_alive_max) svr.set_keep_alive_max_count(o.keep_alive_max);
+    if (o.keep_alive_s)   svr.set_keep_alive_timeout(o.keep_alive_s);
+    if (o.read_timeout_s) svr.set_read_timeout(o.read_timeout_s, 0);
+    svr.set_payload_max_length(o.payload_max);
+}
+
+/* --threads etc. (after prefix); i is advanced past the value. False if argv[i] isn't one */
+inline bool dashboard_option(DashboardOptions& o, int argc, char* argv[], int& i, const char* prefix = "--")
+{
+    auto arg = [&](const char* name) {
+        size_t n = strlen(prefix);
+        return !strncmp(argv[i], prefix, n) && !strcmp(argv[i] + n, name) && i + 1 < argc;
+    };
+    if      (arg("port"))               o.port           = atoi(argv[++i]);
+    else if (arg("threads"))            o.threads        = (size_t)std::max(1, atoi(argv[++i]));
+    else if (arg("streams"))            o.streams        = (size_t)std::max(0, atoi(argv[++i]));
+    else if (arg("keep-alive-max"))     o.keep_alive_max = (size_t)std::max(1, atoi(argv[++i]));
+    else if (arg("keep-alive-timeout")) o.keep_alive_s   = std::max(1, atoi(argv[++i]));
+    else if (arg("read-timeout"))       o.read_timeout_s = std::max(1, atoi(argv[++i]));
+    else if (arg("payload-max"))        o.payload_max    = strtoull(argv[++i], nullptr, 10);
+    else if (arg("web-dir"))            o.web_dir        = argv[++i];
+    else return false;
+    return true;
+}
+
+/* ================= ROUTES ================= */
+/*
+   Everything the dashboard serves, on svr. live is null in --json-files
+   mode; metrics may be null; o.web_dir overrides the compiled-in pages
+   and o.streams caps /api/stream. Hosted by dashboard_server and
+   rvims_server.
+*/
+inline void dashboard_mount(httplib::Server& svr, LiveState* live, MetricsShm* metrics,
+                            const DashboardOptions& o = DashboardOptions())
+{
+    // event history index: full journal now, then follow new appends
+    static SharedEventIndex index(JOURNAL_DIR);
+    index.catch_up();
+    std::cout << "[DASH] Indexed " << index.size() << " events with a GPS fix\n";
+
+    // event ID → stored image, for /api/events/{id}; frame ID → newest image
+    static SharedCaptureIndex captures(IMAGE_STORE_DIR);
+    captures.catch_up();
+    std::cout << "[DASH] Indexed " << captures.size() << " event images\n";
+
+    std::thread([] {
+        while (1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(INDEX_POLL_MS));
+            index.catch_up();
+            captures.catch_up();
+        }
+    }).detach();
+
+    // web/ compiled in, or in memory from disk and reloaded when it changes
+    static AssetCache assets(o.web_dir ? o.web_dir : asset_default_root());
+    assets.load();
+    assets.watch();
+
+    // image packs, mapped once for all requests
+    static ImagePackCache packs(IMAGE_STORE_DIR);
+
+    // new events and images, serialised once for every /api/stream client
+    static SseBroadcast stream;
+    if (live) stream.start(live);
+
+    //  REQUEST TIMING  (pre-routing stamps, logger observes)
+
+    static thread_local uint64_t req_start_ns = 0;
+    svr.set_pre_routing_handler([](const httplib::Request &, httplib::Response &) {
+        req_start_ns = metrics_now_ns();
+        return httplib::Server::HandlerResponse::Unhandled;
+    });
+    svr.set_logger([](const httplib::Request &req, const httplib::Response &) {
+        metric_inc(C_HTTP_REQUESTS);
+        if (req.path == "/api/stream") return;      // lasts as long as the browser stays
+        metric_observe_ns(H_HTTP_HANDLER, metrics_now_ns() - req_start_ns);
+    });
+
+    //  METRICS  (Prometheus text format)
+
+    svr.Get("/metrics", [metrics](const httplib::Request &, httplib::Response &res) {
+        if (!metrics) {
+            res.status = 503;
+            res.set_content("metrics unavailable\n", "text/plain");
+            return;
+        }
+        res.set_content(metrics_prometheus(metrics), "text/plain; version=0.0.4");
+    });
+
+    //  HOME PAGE
+       
+    svr.Get("/", [](const httplib::Request &req, httplib::Response &res) {
+        serve_asset(assets, "/index.html", req, res);
+    });
+
+   
+       //  STM32 PAGE
+      
+    svr.Get("/stm32", [](const httplib::Request &req, httplib::Response &res) {
+        serve_asset(assets, "/stm32.html", req, res);
+    });
+
+    
+     //  ESP32 PAGE
+      
+    svr.Get("/esp32", [](const httplib::Request &req, httplib::Response &res) {
+        serve_asset(assets, "/esp32.html", req, res);
+    });
+
+   
+       //  STM32 DATA API  (shared memory, no file I/O)
+       //  ?since=V: {"version", "complete", "events": [...]} added since V
+      
+    svr.Get("/api/stm32", [live](const httplib::Request &req, httplib::Response &res) {
+        if (req.has_param("since") && !live) {
+            res.status = 400;
+            res.set_content("{\"error\":\"since needs the shared live state\"}", "application/json");
+            return;
+        }
+
+        std::string json;
+        LiveEvent e;
+        if (live) {
+            if (api_not_modified(req, res, live->created, live->events.head.load(std::memory_order_acquire)))
+                return;
+            if (req.has_param("since")) {
+                uint64_t since = strtoull(req.get_param_value("since").c_str(), nullptr, 10);
+                res.set_content(live_delta_json(live->events, since, "events",
+                                    [](const LiveEvent& v) { return event_json(v.ev); }),
+                                "application/json");
+                return;
+            }
+            if (live->events.latest(e)) json = event_json(e.ev);
+        } else {
+            if (api_not_modified(req, res, 0, file_version("data/stm32.json"))) return;
+            json = read_file("data/stm32.json");
+        }
+        if (json.empty()) {
+            res.status = 404;
+            res.set_content("{\"error\":\"no stm32 event yet\"}", "application/json");
+            return;
+        }
+        res.set_content(json, "application/json");
+    });
+
+    
+     //  ESP32 DATA API  (shared memory, no file I/O)
+     //  ?since=V: {"version", "complete", "images": [...]} added since V
+     
+    svr.Get("/api/esp32", [live](const httplib::Request &req, httplib::Response &res) {
+        if (req.has_param("since") && !live) {
+            res.status = 400;
+            res.set_content("{\"error\":\"since needs the shared live state\"}", "application/json");
+            return;
+        }
+
+        std::string json;
+        LiveImage im;
+        if (live) {
+            if (api_not_modified(req, res, live->created, live->images.head.load(std::memory_order_acquire)))
+                return;
+            if (req.has_param("since")) {
+                uint64_t since = strtoull(req.get_param_value("since").c_str(), nullptr, 10);
+                res.set_content(live_delta_json(live->images, since, "images", image_json),
+                                "application/json");
+                return;
+            }
+            if (live->images.latest(im)) json = "[\n" + image_json(im) + "\n]\n";
+        } else {
+            if (api_not_modified(req, res, 0, file_version("data/esp32.json"))) return;
+            json = read_file("data/esp32.json");
+        }
+        if (json.empty()) {
+            res.status = 404;
+            res.set_content("{\"error\":\"no esp32 image yet\"}", "application/json");
+            return;
+        }
+        res.set_content(json, "application/json");
+    });
+
+    /*
+       LIVE STREAM  (server-sent events)
+       "stm32" carries the /api/stm32 object, "image" one /api/esp32
+       entry, "resync" asks the page to reload both over REST. Each
+       subscriber holds a server thread while it is connected; past
+       o.streams of them the page gets a 503 and falls back to polling.
+       */
+    static std::atomic<size_t> streams_open{0};
+    size_t streams_max = o.streams;
+    svr.Get("/api/stream", [live, streams_max](const httplib::Request &req, httplib::Response &res) {
+        if (!live) {
+            res.status = 503;
+            res.set_content("{\"error\":\"live stream needs the shared live state\"}", "application/json");
+            return;
+        }
+        if (streams_open.fetch_add(1) >= streams_max) {
+            streams_open--;
+            res.status = 503;
+            res.set_header("Retry-After", "30");
+            res.set_content("{\"error\":\"too many live streams, poll the REST API\"}", "application/json");
+            return;
+        }
+
+        std::string greeting;
+        uint64_t seq = stream.subscribe(req.get_header_value("Last-Event-ID"), greeting);
+        metric_gauge_add(G_SSE_CLIENTS, 1);
+
+        res.set_header("Cache-Control", "no-cache");
+        res.set_header("X-Accel-Buffering", "no");      // nginx: pass frames through
+        res.set_chunked_content_provider("text/event-stream",
+            [seq, greeting](size_t, httplib::DataSink &sink) mutable {
+                if (!greeting.empty()) {
+                    if (!sink.write(greeting.data(), greeting.size())) return false;
+                    greeting.clear();
+                }
+
+                std::vector<SseBroadcast::Frame> frames;
+                stream.wait(seq, frames, SSE_KEEPALIVE_MS);
+                if (frames.empty()) return sink.write(": ping\n\n", 8);
+                for (const auto& f : frames)
+                    if (!sink.write(f->data(), f->size())) return false;
+                return true;
+            },
+            [](bool) {
+                streams_open--;
+                metric_gauge_add(G_SSE_CLIENTS, -1);
+            });
+    });
+
+    /*
+       EVENT HISTORY API
+       /api/events?bbox=minLon,minLat,maxLon,maxLat&from=T0&to=T1&limit=N
+       bbox is in Leaflet's toBBoxString() order; from/to are UTC epoch
+       seconds (both optional). Results are oldest first.
+       */
+    svr.Get("/api/events", [](const httplib::Request &req, httplib::Response &res) {
+        BBox b{-180, -90, 180, 90};
+        if (req.has_param("bbox") &&
+            (sscanf(req.get_param_value("bbox").c_str(), "%lf,%lf,%lf,%lf",
+                    &b.min_lon, &b.min_lat, &b.max_lon, &b.max_lat) != 4 ||
+             !bbox_valid(b))) {
+            res.status = 400;
+            res.set_content("{\"error\":\"bbox must be minLon,minLat,maxLon,maxLat within"
+                            " -180..180, -90..90\"}", "application/json");
+            return;
+        }
+
+        uint32_t from = 0, to = UINT32_MAX;
+        size_t limit = EVENTS_LIMIT;
+        if (req.has_param("from")) from = strtoul(req.get_param_value("from").c_str(), nullptr, 10);
+        if (req.has_param("to"))   to   = strtoul(req.get_param_value("to").c_str(), nullptr, 10);
+        if (req.has_param("limit"))
+            limit = std::min<size_t>(strtoul(req.get_param_value("limit").c_str(), nullptr, 10),
+                                     EVENTS_LIMIT_MAX);
+
+        if (api_not_modified(req, res, 0, index.version())) return;
+
+        std::vector<IndexedEvent> hits;
+        size_t n = index.query(b, from, to, limit, hits);
+        res.set_content(events_json(n, hits), "application/json");
+    });
+
+    /*
+       ONE EVENT AND ITS IMAGE
+       /api/events/{id}: the journal record plus where its CAPTURE image
+       is stored ("image": null until it arrives)
+       */
+    svr.Get(R"(/api/events/(\d+))", [](const httplib::Request &req, httplib::Response &res) {
+        uint64_t id = strtoull(req.matches[1].str().c_str(), nullptr, 10);
+
+        // the record never changes; its image link can, as images are indexed.
+        // Revalidating costs no journal read; only a reply with a body does.
+        if (api_not_modified(req, res, 0, captures.version())) return;
+
+        EventRecord ev;
+        if (!journal_lookup(JOURNAL_DIR, id, ev)) {
+            res.headers.erase("ETag");      // nothing to revalidate
+            res.status = 404;
+            res.set_content("{\"error\":\"no such event\"}", "application/json");
+            return;
+        }
+
+        CaptureRef img;
+        bool have = id <= UINT32_MAX && captures.find((uint32_t)id, img);
+        res.set_content(capture_json(id, ev, have ? &img : nullptr), "application/json");
+    });
+
+    /*
+       IMAGE SERVING  (pack store, see image_store.h; bytes come from
+                       mapped packs, Range handled by httplib)
+       /images/2026-03-14/42.jpg            image 42 of that day
+           ?size=thumb                      smallest thumbnail that fills
+                                            a gallery tile (image_thumb.h)
+           ?size=2|4|8                      1/2, 1/4 or 1/8 scale
+       /images/image_14/image_14.jpg        pre-store layout: newest
+                                            stored frame 14, else the
+                                            loose file if not migrated
+       */
+    svr.Get(R"(/images/(\d{4}-\d{2}-\d{2})/(\d+)\.jpg)", [](const httplib::Request &req, httplib::Response &res) {
+        std::string day = req.matches[1];
+        uint32_t n = (uint32_t)strtoul(req.matches[2].str().c_str(), nullptr, 10);
+
+        int denom = -1;     // full size
+        if (req.has_param("size")) {
+            std::string size = req.get_param_value("size");
+            denom = size == "thumb" ? 0 : atoi(size.c_str());
+            if (denom != 0 && denom != 2 && denom != 4 && denom != 8) {
+                res.status = 400;
+                res.set_content("size must be thumb, 2, 4 or 8", "text/plain");
+                return;
+            }
+        }
+
+        ImageRecord r;
+        if (!image_store_record(IMAGE_STORE_DIR, day, n, r)) {
+            res.status = 404;
+            res.set_content("Image not found", "text/plain");
+            return;
+        }
+        serve_image(packs, day, n, r, denom, IMAGE_CACHE_CONTROL, req, res);
+    });
+
+    svr.Get(R"(/images/image_(\d+)/image_(\d+)\.jpg)", [](const httplib::Request &req, httplib::Response &res) {
+        // frame IDs are 16 bits: anything larger names no image
+        errno = 0;
+        unsigned long id_ul = strtoul(req.matches[1].str().c_str(), nullptr, 10);
+        if (errno == ERANGE || id_ul > UINT16_MAX) {
+            res.status = 404;
+            res.set_content("Image not found", "text/plain");
+            return;
+        }
+        uint16_t frame_id = (uint16_t)id_ul;
+
+        // which image this names changes as frame IDs are reused: revalidate
+        CaptureRef c;
+        ImageRecord r;
+        if (captures.find_frame(frame_id, c) &&
+            image_store_record(IMAGE_STORE_DIR, c.day, c.n, r)) {
+            serve_image(packs, c.day, c.n, r, -1, "no-cache", req, res);
+            return;
+        }
+
+        // not migrated: image_<id>/image_<id>.jpg below the working directory only
+        std::string id = std::to_string(frame_id);
+        std::string path = "image_" + id + "/image_" + id + ".jpg";
+        char real[PATH_MAX], cwd[PATH_MAX];
+        struct stat st;
+        std::shared_ptr<const ImageMapping> m;
+        if (realpath(path.c_str(), real) && getcwd(cwd, sizeof(cwd)) &&
+            !strncmp(real, cwd, strlen(cwd)) && real[strlen(cwd)] == '/' &&
+            stat(real, &st) == 0 && S_ISREG(st.st_mode))
+            m = image_map_file(real);
+        if (!m) {
+            res.status = 404;
+            res.set_content("Image not found", "text/plain");
+            return;
+        }
+        res.set_header("Last-Modified", http_date(st.st_mtime));
+        res.set_header("Cache-Control", "no-cache");
+        if (not_modified(req, "", st.st_mtime)) {
+            res.status = 304;
+            return;
+        }
+        serve_mapped(m, m->base, m->size, res);
+    });
+
+   
+     //  STATIC JS
+      
+    svr.Get(R"(/js/(.*))", [](const httplib::Request &req, httplib::Response &res) {
+        serve_asset(assets, req.path, req, res);
+    });
+
+    
+     //  STATIC CSS
+      
+    svr.Get(R"(/css/(.*))", [](const httplib::Request &req, httplib::Response &res) {
+        serve_asset(assets, req.path, req, res);
+    });
+}
@@ -0,0 +1,255 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "event_journal.h"
+
+/*
+   In-memory spatial/temporal index over the event journal.
+
+   Events with a GPS fix are bucketed into a fixed lat/lon grid of
+   GRID_DEG cells (~1 km at 0.01°). Each cell keeps its events sorted
+   by time, so a query walks only the cells overlapping the bounding
+   box, binary-searches the time window in each, and filters by exact
+   position only in the cells on the box edge.
+
+   Built once from the journal at startup, then extended by tailing it.
+   Readers (HTTP threads) take a shared lock; the tailer takes it
+   exclusively for the few microseconds of an append.
+*/
+
+#define GRID_DEG        0.01
+#define GRID_LAT_CELLS  18000           // -90 .. 90
+#define GRID_LON_CELLS  36000           // -180 .. 180
+
+struct IndexedEvent {
+    uint64_t id;            // journal sequence
+    uint32_t t;             // UTC seconds: GPS epoch, else server rx time
+    int32_t  lat_e7;
+    int32_t  lon_e7;
+    uint32_t device_id;
+    uint16_t peak_mg;
+};
+
+struct BBox {
+    double min_lon, min_lat, max_lon, max_lat;
+};
+
+/* finite, on the globe and not inverted: query() converts to int32 cells */
+inline bool bbox_valid(const BBox& b)
+{
+    for (double v : {b.min_lon, b.min_lat, b.max_lon, b.max_lat})
+        if (!std::isfinite(v)) return false;
+    return b.min_lon >= -180 && b.max_lon <= 180 && b.min_lon <= b.max_lon &&
+           b.min_lat >=  -90 && b.max_lat <=  90 && b.min_lat <= b.max_lat;
+}
+
+class EventIndex {
+public:
+    void add(uint64_t id, const EventRecord& ev)
+    {
+        if (id < next_id_) return;
+        next_id_ = id + 1;
+
+        if (!ev.has_fix || std::fabs(ev.lat) > 90 || std::fabs(ev.lon) > 180) return;
+
+        IndexedEvent e;
+        e.id        = id;
+        e.t         = ev.epoch ? ev.epoch : ev.rx_time;
+        e.lat_e7    = (int32_t)std::lround(ev.lat * 1e7);
+        e.lon_e7    = (int32_t)std::lround(ev.lon * 1e7);
+        e.device_id = ev.device_id;
+        e.peak_mg   = ev.peak_mg;
+
+        std::vector<IndexedEvent>& cell = cells_[cell_key(lat_cell(ev.lat), lon_cell(ev.lon))];
+
+        /* events arrive almost in time order; keep the cell sorted anyway */
+        if (cell.empty() || cell.back().t <= e.t)
+            cell.push_back(e);
+        else
+            cell.insert(std::upper_bound(cell.begin(), cell.end(), e.t,
+                                         [](uint32_t t, const IndexedEvent& x) { return t < x.t; }),
+                        e);
+        size_++;
+    }
+
+    /*
+       The oldest `limit` events inside box with from <= t <= to, in time
+       order. Returns the total number of matches (may exceed out.size()).
+    */
+    size_t query(const BBox& b, uint32_t from, uint32_t to, size_t limit,
+                 std::vector<IndexedEvent>& out) const
+    {
+        int32_t lat0 = lat_cell(b.min_lat), lat1 = lat_cell(b.max_lat);
+        int32_t lon0 = lon_cell(b.min_lon), lon1 = lon_cell(b.max_lon);
+
+        int32_t min_lat_e7 = (int32_t)std::lround(b.min_lat * 1e7);
+        int32_t max_lat_e7 = (int32_t)std::lround(b.max_lat * 1e7);
+        int32_t min_lon_e7 = (int32_t)std::lround(b.min_lon * 1e7);
+        int32_t max_lon_e7 = (int32_t)std::lround(b.max_lon * 1e7);
+
+        size_t matches = 0;
+
+        /* out is a max-heap on time while filling, so a capped reply keeps the oldest */
+        auto later = [](const IndexedEvent& a, const IndexedEvent& b) { return a.t < b.t; };
+        auto take = [&](const IndexedEvent& e) {
+            if (out.size() < limit) {
+                out.push_back(e);
+                std::push_heap(out.begin(), out.end(), later);
+            } else if (limit && e.t < out.front().t) {
+                std::pop_heap(out.begin(), out.end(), later);
+                out.back() = e;
+                std::push_heap(out.begin(), out.end(), later);
+            }
+        };
+
+        auto scan = [&](int32_t la, int32_t lo, const std::vector<IndexedEvent>& cell) {
+            auto first = std::lower_bound(cell.begin(), cell.end(), from,
+                                          [](const IndexedEvent& x, uint32_t t) { return x.t < t; });
+            auto last  = std::upper_bound(first, cell.end(), to,
+                                          [](uint32_t t, const IndexedEvent& x) { return t < x.t; });
+
+            bool edge = la == lat0 || la == lat1 || lo == lon0 || lo == lon1;
+            if (!edge) {
+                /* interior cell: every event in the window matches */
+                matches += last - first;
+                for (auto it = first; it != last; ++it) {
+                    if (out.size() == limit && (!limit || it->t >= out.front().t)) break;
+                    take(*it);
+                }
+                return;
+            }
+
+            for (auto it = first; it != last; ++it) {
+                if (it->lat_e7 < min_lat_e7 || it->lat_e7 > max_lat_e7 ||
+                    it->lon_e7 < min_lon_e7 || it->lon_e7 > max_lon_e7)
+                    continue;
+                matches++;
+                take(*it);
+            }
+        };
+
+        /* small boxes: probe each covered cell; huge ones: walk the occupied cells */
+        uint64_t covered = (uint64_t)(lat1 - lat0 + 1) * (uint64_t)(lon1 - lon0 + 1);
+        if (covered <= cells_.size()) {
+            for (int32_t la = lat0; la <= lat1; la++)
+                for (int32_t lo = lon0; lo <= lon1; lo++) {
+                    auto it = cells_.find(cell_key(la, lo));
+                    if (it != cells_.end()) scan(la, lo, it->second);
+                }
+        } else {
+            for (auto& kv : cells_) {
+                int32_t la = (int32_t)(kv.first / GRID_LON_CELLS);
+                int32_t lo = (int32_t)(kv.first % GRID_LON_CELLS);
+                if (la >= lat0 && la <= lat1 && lo >= lon0 && lo <= lon1)
+                    scan(la, lo, kv.second);
+            }
+        }
+
+        std::sort_heap(out.begin(), out.end(), later);
+        return matches;
+    }
+
+    uint64_t next_id() const { return next_id_; }
+    size_t   size()    const { return size_; }
+
+private:
+    static int32_t lat_cell(double lat)
+    {
+        return std::clamp((int32_t)std::floor((lat + 90.0) / GRID_DEG), 0, GRID_LAT_CELLS - 1);
+    }
+    static int32_t lon_cell(double lon)
+    {
+        return std::clamp((int32_t)std::floor((lon + 180.0) / GRID_DEG), 0, GRID_LON_CELLS - 1);
+    }
+    static uint32_t cell_key(int32_t la, int32_t lo)
+    {
+        return (uint32_t)la * GRID_LON_CELLS + (uint32_t)lo;
+    }
+
+    std::unordered_map<uint32_t, std::vector<IndexedEvent>> cells_;
+    uint64_t next_id_ = 1;
+    size_t   size_    = 0;
+};
+
+/* EventIndex + its lock + journal tailing, as used by the dashboard */
+class SharedEventIndex {
+public:
+    explicit SharedEventIndex(std::string dir = JOURNAL_DIR) : dir_(std::move(dir)) {}
+
+    /* pull everything appended since the last call */
+    size_t catch_up()
+    {
+        /* read outside the lock, publish in one short critical section */
+        std::vector<std::pair<uint64_t, EventRecord>> fresh;
+        uint64_t from;
+        {
+            std::shared_lock<std::shared_mutex> lk(mu_);
+            from = index_.next_id();
+        }
+        journal_replay(dir_, from, [&](uint64_t id, const EventRecord& ev) {
+            fresh.emplace_back(id, ev);
+        });
+        if (fresh.empty()) return 0;
+
+        std::unique_lock<std::shared_mutex> lk(mu_);
+        for (auto& f : fresh) index_.add(f.first, f.second);
+        return fresh.size();
+    }
+
+    size_t query(const BBox& b, uint32_t from, uint32_t to, size_t limit,
+                 std::vector<IndexedEvent>& out) const
+    {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        return index_.query(b, from, to, limit, out);
+    }
+
+    size_t size() const
+    {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        return index_.size();
+    }
+
+    /* next journal ID to index: grows with every event added */
+    uint64_t version() const
+    {
+        std::shared_lock<std::shared_mutex> lk(mu_);
+        return index_.next_id();
+    }
+
+private:
+    std::string               dir_;
+    mutable std::shared_mutex mu_;
+    EventIndex                index_;
+};
+
+/* ================= JSON VIEW ================= */
+inline std::string events_json(size_t matches, const std::vector<IndexedEvent>& evs)
+{
+    std::string out;
+    out.reserve(64 + evs.size() * 112);
+
+    char buf[160];
+    snprintf(buf, sizeof(buf), "{\"count\":%zu,\"truncated\":%s,\"events\":[",
+             matches, matches > evs.size() ? "true" : "false");
+    out += buf;
+
+    for (size_t i = 0; i < evs.size(); i++) {
+        const IndexedEvent& e = evs[i];
+        snprintf(buf, sizeof(buf),
+                 "%s{\"id\":%llu,\"time\":%u,\"lat\":%.7f,\"lon\":%.7f,"
+                 "\"device\":%u,\"peak_mg\":%u}",
+                 i ? "," : "", (unsigned long long)e.id, e.t,
+                 e.lat_e7 / 1e7, e.lon_e7 / 1e7, e.device_id, (unsigned)e.peak_mg);
+        out += buf;
+    }
+    out += "]}\n";
+    return out;
+}
@@ -0,0 +1,451 @@
+#pragma once
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <ctime>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+
+#include "event_journal.h"
+#include "event_parser.h"
+#include "live_state.h"
+#include "metrics.h"
+#include "event_proto.h"
+
+/*
+   STM32 event ingest: one epoll loop over every board connection.
+   Events are journaled, published to the live state and, for 2G
+   events, turned into a CAPTURE command for the ESP32. Hosted by
+   event_server and by rvims_server.
+*/
+
+/* ================= CONFIG ================= */
+#define TCP_PORT        5000
+#define ESP32_IP        "192.168.1.100"
+#define ESP32_CMD_PORT  9100
+
+#define MAX_EVENTS      256     // epoll_wait batch
+#define SWEEP_MS        1000    // idle sweep period
+
+/* TCP keepalive: reaps boards that vanish without a FIN */
+#define KEEPALIVE_IDLE  60
+#define KEEPALIVE_INTVL 10
+#define KEEPALIVE_CNT   3
+
+
+/* ================= HELPERS ================= */
+/*
+   Compatibility mode (--json-files): data/stm32.json as a derived view
+   of the journal tail, written to a temp file and renamed so a reader
+   never sees it torn. The dashboard normally reads shared memory.
+*/
+inline void write_stm32_json(const EventRecord& ev)
+{
+    std::ofstream f("data/stm32.json.tmp");
+    if (!f.is_open()) return;
+
+    f << event_json(ev);
+    f.close();
+    rename("data/stm32.json.tmp", "data/stm32.json");
+}
+
+inline uint64_t now_ms()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+inline bool set_nonblocking(int fd)
+{
+    int fl = fcntl(fd, F_GETFL, 0);
+    return fl >= 0 && fcntl(fd, F_SETFL, fl | O_NONBLOCK) == 0;
+}
+
+/* v2 binary frame → typed record */
+inline void decode_event_v2(const event_frame_v2_t& f, EventRecord& ev)
+{
+    memset(&ev, 0, sizeof(ev));
+    strcpy(ev.event, f.type == EVENT_V2_TYPE_2G ? "2G" : "UNKNOWN");
+
+    ev.device_id = f.device_id;
+    ev.seq       = f.seq;
+    ev.peak_mg   = f.peak_mg;
+
+    if (f.flags & EVENT_V2_FLAG_FIX) {
+        ev.has_fix = 1;
+        ev.lat     = f.lat_e7 / 1e7;
+        ev.lon     = f.lon_e7 / 1e7;
+        ev.epoch   = f.epoch;
+        set_civil_from_epoch(ev, f.epoch);
+    }
+}
+
+/* ================= CONNECTIONS ================= */
+/*
+   One entry per STM32 board. All sockets are non-blocking and
+   registered edge-triggered, so a board that stops sending (or
+   sends slowly) only ever costs an epoll slot.
+
+   The wire protocol is picked from the first byte a board sends:
+   'E' → legacy text lines, 0xA5 → v2 binary frames.
+*/
+enum Proto : uint8_t { PROTO_UNKNOWN, PROTO_TEXT, PROTO_V2 };
+
+struct Connection {
+    int         fd = -1;
+    std::string peer;
+    uint64_t    last_rx_ms = 0;
+    uint64_t    rx_events  = 0;
+    uint64_t    bad_frames = 0;
+    bool        resyncing  = false;
+    Proto       proto = PROTO_UNKNOWN;
+    LineFramer  rx;             // partial lines carried across recv()s
+};
+
+struct IngestServer {
+    int      epfd = -1;
+    int      listen_fd = -1;
+    int      udp = -1;
+    sockaddr_in esp{};
+    uint32_t idle_timeout_ms = 0;   // 0 = rely on keepalive only
+    uint32_t sync_ms = 0;           // journal group-commit interval
+
+    EventJournal journal;
+    LiveState*   live = nullptr;
+    bool         json_files = false;
+    bool         verbose = false;       // log every event received
+
+    std::unordered_map<int, Connection> conns;
+};
+
+inline void close_conn(IngestServer& s, int fd, const char* why)
+{
+    auto it = s.conns.find(fd);
+    if (it == s.conns.end()) return;
+
+    std::cout << "[SERVER] STM32 " << it->second.peer
+              << " closed (" << why << "), "
+              << s.conns.size() - 1 << " connected\n";
+
+    epoll_ctl(s.epfd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    s.conns.erase(it);
+
+    metric_inc(C_CONNS_CLOSED);
+    metric_gauge_add(G_CONNS_OPEN, -1);
+}
+
+/* rx_ns: monotonic time the bytes carrying this event were read */
+inline void handle_event(IngestServer& s, EventRecord& ev, uint64_t rx_ns)
+{
+    ev.rx_time = (uint32_t)time(nullptr);
+
+    /* JOURNAL FIRST, THEN THE LIVE VIEWS */
+    uint64_t id;
+    {
+        ScopedTimer t(H_DISK_WRITE_JOURNAL);
+        id = s.journal.append(ev);
+    }
+    if (id == 0) {
+        /* no segment to write to: an unjournalled event has no ID to file its image under */
+        std::cerr << "[SERVER] journal append failed, dropping event\n";
+        return;
+    }
+    s.live->publish_event(LiveEvent{id, ev});
+    if (s.json_files) write_stm32_json(ev);
+
+    /* 2G DETECT → ESP32 IMAGE CAPTURE (the event ID comes back in the image header) */
+    if (ev.is("2G")) {
+        char cmd[32];
+        int n = snprintf(cmd, sizeof(cmd), "CAPTURE:%llu", (unsigned long long)id);
+        sendto(s.udp, cmd, n, 0,
+               (sockaddr*)&s.esp, sizeof(s.esp));
+
+        metric_inc(C_CAPTURES_SENT);
+        metric_observe_ns(H_CAPTURE_TRIGGER, metrics_now_ns() - rx_ns);
+
+        std::cout << "[SERVER] CMD → ESP32: " << cmd << '\n';
+    }
+}
+
+inline void drain_text(IngestServer& s, Connection& c, uint64_t rx_ns)
+{
+    std::string_view line;
+    while (c.rx.next_line(line)) {
+        if (s.verbose) std::cout << "[SERVER] RX " << c.peer << ": " << line << '\n';
+
+        EventRecord ev;
+        bool ok;
+        {
+            ScopedTimer t(H_EVENT_PARSE);
+            ok = parse_event(line, ev);
+        }
+        if (!ok) {
+            metric_inc(C_EVENTS_BAD);
+            continue;
+        }
+
+        c.rx_events++;
+        metric_inc(C_EVENTS_TEXT);
+        handle_event(s, ev, rx_ns);
+    }
+}
+
+inline void drain_v2(IngestServer& s, Connection& c, uint64_t rx_ns)
+{
+    while (c.rx.size() >= sizeof(event_frame_v2_t)) {
+        event_frame_v2_t f;
+        memcpy(&f, c.rx.data(), sizeof(f));
+
+        /* bad magic or CRC: slide one byte and try to resync */
+        uint64_t t0 = metrics_now_ns();     // decode time of valid frames only
+        if (!event_v2_valid(&f)) {
+            c.rx.consume(1);
+            if (!c.resyncing) {
+                c.bad_frames++;
+                metric_inc(C_EVENTS_BAD);
+            }
+            c.resyncing = true;
+            continue;
+        }
+        EventRecord ev;
+        decode_event_v2(f, ev);
+        metric_observe_ns(H_EVENT_PARSE, metrics_now_ns() - t0);
+
+        c.rx.consume(sizeof(f));
+        c.resyncing = false;
+
+        if (s.verbose)
+            std::cout << "[SERVER] RX " << c.peer << ": v2 dev=" << f.device_id
+                      << " seq=" << f.seq << '\n';
+
+        c.rx_events++;
+        metric_inc(C_EVENTS_V2);
+        handle_event(s, ev, rx_ns);
+    }
+}
+
+inline void accept_all(IngestServer& s)
+{
+    /* edge-triggered: drain the whole accept queue */
+    while (1) {
+        sockaddr_in peer{};
+        socklen_t plen = sizeof(peer);
+        int fd = accept4(s.listen_fd, (sockaddr*)&peer, &plen,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                std::cerr << "[SERVER] accept: " << strerror(errno) << '\n';
+            return;
+        }
+
+        int on = 1, idle = KEEPALIVE_IDLE, intvl = KEEPALIVE_INTVL, cnt = KEEPALIVE_CNT;
+        setsockopt(fd, SOL_SOCKET,  SO_KEEPALIVE,  &on,    sizeof(on));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE,  &idle,  sizeof(idle));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &intvl, sizeof(intvl));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT,   &cnt,   sizeof(cnt));
+
+        epoll_event ev{};
+        ev.events  = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        if (epoll_ctl(s.epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            continue;
+        }
+
+        char ip[INET_ADDRSTRLEN] = "?";
+        inet_ntop(AF_INET, &peer.sin_addr, ip, sizeof(ip));
+
+        Connection& c = s.conns[fd];
+        c.fd         = fd;
+        c.peer       = std::string(ip) + ":" + std::to_string(ntohs(peer.sin_port));
+        c.last_rx_ms = now_ms();
+
+        metric_inc(C_CONNS_ACCEPTED);
+        metric_gauge_add(G_CONNS_OPEN, 1);
+
+        std::cout << "[SERVER] STM32 connected " << c.peer
+                  << ", " << s.conns.size() << " connected\n";
+    }
+}
+
+inline void read_conn(IngestServer& s, int fd)
+{
+    auto it = s.conns.find(fd);
+    if (it == s.conns.end()) return;
+    Connection& c = it->second;
+
+    /* edge-triggered: read until EAGAIN or the peer goes away */
+    while (1) {
+        char* dst = c.rx.write_ptr();           // may compact: call first
+        ssize_t n = recv(fd, dst, c.rx.write_space(), 0);
+        if (n > 0) {
+            c.rx.commit(n);
+            c.last_rx_ms = now_ms();
+
+            if (c.proto == PROTO_UNKNOWN)
+                c.proto = (uint8_t)c.rx.data()[0] == (EVENT_V2_MAGIC & 0xFF)
+                              ? PROTO_V2 : PROTO_TEXT;
+
+            uint64_t rx_ns = metrics_now_ns();
+            if (c.proto == PROTO_V2) drain_v2(s, c, rx_ns);
+            else                     drain_text(s, c, rx_ns);
+            continue;
+        }
+        if (n == 0) {
+            close_conn(s, fd, "peer closed");
+            return;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+
+        close_conn(s, fd, strerror(errno));
+        return;
+    }
+}
+
+inline void sweep_idle(IngestServer& s)
+{
+    if (!s.idle_timeout_ms) return;
+
+    uint64_t now = now_ms();
+    for (auto it = s.conns.begin(); it != s.conns.end(); ) {
+        int fd = it->first;
+        bool idle = now - it->second.last_rx_ms > s.idle_timeout_ms;
+        ++it;
+        if (idle) close_conn(s, fd, "idle timeout");
+    }
+}
+
+/* ================= SETUP ================= */
+struct IngestOptions {
+    int            port            = TCP_PORT;
+    const char*    esp_ip          = ESP32_IP;
+    uint32_t       idle_timeout_ms = 0;
+    bool           json_files      = false;
+    bool           verbose         = false;
+    JournalOptions journal;
+};
+
+/* journal, live state seeding and sockets; false (with a message) on failure */
+inline bool ingest_open(IngestServer& s, const IngestOptions& o, LiveState* live)
+{
+    s.idle_timeout_ms = o.idle_timeout_ms;
+    s.json_files      = o.json_files;
+    s.verbose         = o.verbose;
+    s.sync_ms         = o.journal.sync_ms;
+    s.live            = live;
+
+    /* ---------- EVENT JOURNAL ---------- */
+    if (!s.journal.open(o.journal)) {
+        std::cerr << "[SERVER] journal " << o.journal.dir << ": " << strerror(errno) << '\n';
+        return false;
+    }
+    std::cout << "[SERVER] Journal: " << s.journal.next_seq() - 1 << " events";
+    if (s.journal.recovered_torn())
+        std::cout << ", dropped " << s.journal.recovered_torn() << " torn records";
+    std::cout << '\n';
+
+    /* after a reboot the live state is empty: seed it from the journal tail */
+    if (s.journal.next_seq() > 1)
+        journal_replay(o.journal.dir, s.journal.next_seq() - 1,
+                       [&](uint64_t id, const EventRecord& ev) {
+                           LiveEvent last;
+                           if (!s.live->events.latest(last) || last.id != id)
+                               s.live->publish_event(LiveEvent{id, ev});
+                           if (s.json_files) write_stm32_json(ev);
+                       });
+
+    /* ---------- TCP SERVER (STM32) ---------- */
+    s.listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    int on = 1;
+    setsockopt(s.listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    sockaddr_in srv{};
+    srv.sin_family = AF_INET;
+    srv.sin_port   = htons(o.port);
+    srv.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(s.listen_fd, (sockaddr*)&srv, sizeof(srv)) < 0 ||
+        listen(s.listen_fd, SOMAXCONN) < 0) {
+        std::cerr << "[SERVER] bind/listen " << o.port << ": " << strerror(errno) << '\n';
+        return false;
+    }
+
+    s.epfd = epoll_create1(EPOLL_CLOEXEC);
+
+    epoll_event lev{};
+    lev.events  = EPOLLIN | EPOLLET;
+    lev.data.fd = s.listen_fd;
+    epoll_ctl(s.epfd, EPOLL_CTL_ADD, s.listen_fd, &lev);
+
+    /* ---------- UDP SOCKET (ESP32) ---------- */
+    s.udp = socket(AF_INET, SOCK_DGRAM, 0);
+    set_nonblocking(s.udp);     // never stall ingest on the capture hop
+
+    s.esp.sin_family = AF_INET;
+    s.esp.sin_port   = htons(ESP32_CMD_PORT);
+    inet_pton(AF_INET, o.esp_ip, &s.esp.sin_addr);
+
+    std::cout << "[SERVER] Waiting for STM32 boards on port " << o.port << "...\n";
+    return true;
+}
+
+/* ================= MAIN LOOP ================= */
+/* runs until epoll fails */
+inline void ingest_run(IngestServer& s)
+{
+    epoll_event events[MAX_EVENTS];
+    uint64_t next_sweep = now_ms() + SWEEP_MS;
+    int wait_ms = s.sync_ms ? std::min<int>(SWEEP_MS, s.sync_ms) : SWEEP_MS;
+
+    while (1) {
+        int n = epoll_wait(s.epfd, events, MAX_EVENTS, wait_ms);
+        if (n < 0 && errno != EINTR) {
+            std::cerr << "[SERVER] epoll_wait: " << strerror(errno) << '\n';
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+
+            if (fd == s.listen_fd) {
+                accept_all(s);
+                continue;
+            }
+
+            /* read first so data sent just before a FIN is not lost */
+            if (events[i].events & EPOLLIN)
+                read_conn(s, fd);
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+                close_conn(s, fd, "hangup");
+        }
+
+        s.journal.tick();
+
+        uint64_t now = now_ms();
+        if (now >= next_sweep) {
+            sweep_idle(s);
+            next_sweep = now + SWEEP_MS;
+        }
+    }
+
+    for (auto& kv : s.conns) close(kv.first);
+    s.conns.clear();
+    close(s.listen_fd);
+    close(s.epfd);
+    close(s.udp);
+}
@@ -0,0 +1,348 @@
+#pragma once
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "event_record.h"
+
+/*
+   Append-only event journal.
+
+   data/journal/events-<first seq>.seg, each a preallocated file of
+   JOURNAL_SEG_RECORDS fixed 64-byte records written through a shared
+   mmap. An event's sequence number (its global event ID) is the
+   segment's first seq plus the slot index, so it is never stored.
+   Segments are only ever started at a multiple of JOURNAL_SEG_RECORDS
+   (plus one), so the segment holding a seq is known without listing
+   the directory.
+
+   A slot is valid when its magic is set and the CRC matches. The magic
+   is stored last with release ordering, so a reader mapping the same
+   file never sees a half-written record. On open the newest segment is
+   scanned up to the first invalid slot; anything after it (a torn tail
+   from a crash) is zeroed.
+*/
+
+#define JOURNAL_DIR             "data/journal"
+#define JOURNAL_SEG_RECORDS     65536           // 4 MiB per segment
+#define JOURNAL_MAGIC           0x314A5652u     // "RVJ1"
+#define JOURNAL_READ_FDS        16              // segments journal_lookup() keeps open
+
+struct JournalRecord {
+    uint32_t    magic;
+    uint32_t    crc32;      // over ev
+    EventRecord ev;
+};
+
+static_assert(sizeof(JournalRecord) == 64, "journal record must stay 64 bytes");
+
+#define JOURNAL_SEG_BYTES   ((size_t)JOURNAL_SEG_RECORDS * sizeof(JournalRecord))
+
+inline uint32_t journal_crc32(const void* data, size_t len)
+{
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t crc = 0xFFFFFFFFu;
+    while (len--) crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+inline bool journal_slot_valid(const JournalRecord& r)
+{
+    uint32_t magic = __atomic_load_n(&r.magic, __ATOMIC_ACQUIRE);
+    return magic == JOURNAL_MAGIC && r.crc32 == journal_crc32(&r.ev, sizeof(r.ev));
+}
+
+/* first seq of every segment in dir, ascending */
+inline std::vector<uint64_t> journal_segments(const std::string& dir)
+{
+    std::vector<uint64_t> segs;
+
+    DIR* d = opendir(dir.c_str());
+    if (!d) return segs;
+
+    while (dirent* e = readdir(d)) {
+        unsigned long long first;
+        char tail;
+        if (sscanf(e->d_name, "events-%llu.se%c", &first, &tail) == 2 && tail == 'g')
+            segs.push_back(first);
+    }
+    closedir(d);
+
+    std::sort(segs.begin(), segs.end());
+    return segs;
+}
+
+inline std::string journal_seg_path(const std::string& dir, uint64_t first)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/events-%016llu.seg", (unsigned long long)first);
+    return dir + name;
+}
+
+/* ================= WRITER ================= */
+/*
+   Durability policy (group commit): dirty records are msync()ed once
+   sync_every records have accumulated or sync_ms has passed since the
+   oldest unsynced append, whichever comes first. 0/0 leaves writeback
+   to the kernel; 1 syncs every event.
+*/
+struct JournalOptions {
+    std::string dir        = JOURNAL_DIR;
+    uint32_t    sync_every = 64;
+    uint32_t    sync_ms    = 200;
+};
+
+class EventJournal {
+public:
+    ~EventJournal() { close_seg(); }
+
+    /* open (or create) the journal and recover the tail */
+    bool open(const JournalOptions& opt)
+    {
+        opt_ = opt;
+        mkdir("data", 0777);
+        mkdir(opt_.dir.c_str(), 0777);
+
+        auto segs = journal_segments(opt_.dir);
+        if (segs.empty()) return open_seg(1);
+
+        if (!open_seg(segs.back())) return false;
+
+        /* crash recovery: valid prefix of the newest segment */
+        uint32_t n = 0;
+        while (n < JOURNAL_SEG_RECORDS && journal_slot_valid(map_[n])) n++;
+
+        uint32_t torn = 0;
+        for (uint32_t i = n; i < JOURNAL_SEG_RECORDS; i++) {
+            if (map_[i].magic == 0) continue;
+            memset(&map_[i], 0, sizeof(JournalRecord));
+            torn++;
+        }
+        if (torn) msync(map_, JOURNAL_SEG_BYTES, MS_SYNC);
+
+        fill_ = n;
+        synced_ = n;
+        recovered_torn_ = torn;
+        return true;
+    }
+
+    /* append one event; returns its global sequence number (event ID),
+       or 0 if the next segment could not be opened */
+    uint64_t append(const EventRecord& ev)
+    {
+        if (fill_ == JOURNAL_SEG_RECORDS && !roll()) return 0;
+
+        JournalRecord& r = map_[fill_];
+        r.ev    = ev;
+        r.crc32 = journal_crc32(&r.ev, sizeof(r.ev));
+        __atomic_store_n(&r.magic, JOURNAL_MAGIC, __ATOMIC_RELEASE);
+
+        if (fill_ == synced_) first_unsynced_ms_ = mono_ms();
+        fill_++;
+
+        if (opt_.sync_every && fill_ - synced_ >= opt_.sync_every) sync();
+        return first_ + fill_ - 1;
+    }
+
+    /* time-based half of the group commit; call from the event loop */
+    void tick()
+    {
+        if (fill_ > synced_ && opt_.sync_ms &&
+            mono_ms() - first_unsynced_ms_ >= opt_.sync_ms)
+            sync();
+    }
+
+    void sync()
+    {
+        if (fill_ == synced_) return;
+
+        /* msync wants page-aligned start */
+        size_t page  = (size_t)sysconf(_SC_PAGESIZE);
+        size_t begin = (size_t)synced_ * sizeof(JournalRecord) / page * page;
+        size_t end   = (size_t)fill_ * sizeof(JournalRecord);
+        msync((char*)map_ + begin, end - begin, MS_SYNC);
+
+        synced_ = fill_;
+    }
+
+    uint64_t next_seq()       const { return first_ + fill_; }
+    uint32_t recovered_torn() const { return recovered_torn_; }
+
+private:
+    static uint64_t mono_ms()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    }
+
+    bool open_seg(uint64_t first)
+    {
+        std::string path = journal_seg_path(opt_.dir, first);
+
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) return false;
+
+        /* reserve the whole segment up front: appends never extend the file */
+        if (posix_fallocate(fd_, 0, JOURNAL_SEG_BYTES) != 0 &&
+            ftruncate(fd_, JOURNAL_SEG_BYTES) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+
+        void* p = mmap(nullptr, JOURNAL_SEG_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) {
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+
+        map_    = (JournalRecord*)p;
+        first_  = first;
+        fill_   = 0;
+        synced_ = 0;
+        return true;
+    }
+
+    void close_seg()
+    {
+        if (!map_) return;
+        sync();
+
+        munmap(map_, JOURNAL_SEG_BYTES);
+        ::close(fd_);
+        map_ = nullptr;
+        fd_  = -1;
+    }
+
+    bool roll()
+    {
+        uint64_t next = first_ + fill_;
+        close_seg();
+        return open_seg(next);
+    }
+
+    JournalOptions opt_;
+    int            fd_  = -1;
+    JournalRecord* map_ = nullptr;
+    uint64_t       first_  = 1;
+    uint32_t       fill_   = 0;
+    uint32_t       synced_ = 0;
+    uint64_t       first_unsynced_ms_ = 0;
+    uint32_t       recovered_torn_ = 0;
+};
+
+/* ================= READER ================= */
+inline uint64_t journal_seg_first(uint64_t seq)
+{
+    return (seq - 1) / JOURNAL_SEG_RECORDS * JOURNAL_SEG_RECORDS + 1;
+}
+
+struct JournalReadFd {
+    int fd;
+    ~JournalReadFd() { ::close(fd); }
+};
+
+/* read-only fd of a segment, from a small most-recently-used cache */
+inline std::shared_ptr<JournalReadFd> journal_read_fd(const std::string& dir, uint64_t first)
+{
+    struct Entry {
+        std::string                    dir;
+        uint64_t                       first;
+        std::shared_ptr<JournalReadFd> fd;
+    };
+    static std::mutex         mu;
+    static std::vector<Entry> open;     // most recent last
+
+    std::lock_guard<std::mutex> lk(mu);
+    for (size_t i = 0; i < open.size(); i++)
+        if (open[i].first == first && open[i].dir == dir) {
+            std::rotate(open.begin() + i, open.begin() + i + 1, open.end());
+            return open.back().fd;
+        }
+
+    // failures aren't cached: the segment may just not exist yet
+    int fd = ::open(journal_seg_path(dir, first).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+
+    if (open.size() == JOURNAL_READ_FDS) open.erase(open.begin());
+    open.push_back({dir, first, std::shared_ptr<JournalReadFd>(new JournalReadFd{fd})});
+    return open.back().fd;
+}
+
+/* one event by sequence number: a single pread on a cached fd, no mapping */
+inline bool journal_lookup(const std::string& dir, uint64_t seq, EventRecord& ev)
+{
+    if (seq == 0) return false;
+
+    uint64_t first = journal_seg_first(seq);
+    std::shared_ptr<JournalReadFd> f = journal_read_fd(dir, first);
+    if (!f) return false;
+
+    JournalRecord r;
+    bool ok = pread(f->fd, &r, sizeof(r), (off_t)((seq - first) * sizeof(r))) == (ssize_t)sizeof(r) &&
+              journal_slot_valid(r);
+
+    if (ok) ev = r.ev;
+    return ok;
+}
+
+/*
+   Replays every valid record with seq >= from, oldest first. Safe to
+   run while the writer is appending; it stops at the current tail.
+*/
+inline uint64_t journal_replay(const std::string& dir, uint64_t from,
+                               const std::function<void(uint64_t, const EventRecord&)>& fn)
+{
+    auto segs = journal_segments(dir);
+    uint64_t next = from;
+
+    for (size_t i = 0; i < segs.size(); i++) {
+        uint64_t first = segs[i];
+        if (i + 1 < segs.size() && segs[i + 1] <= from) continue;
+
+        int fd = ::open(journal_seg_path(dir, first).c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+
+        void* p = mmap(nullptr, JOURNAL_SEG_BYTES, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) continue;
+
+        const JournalRecord* recs = (const JournalRecord*)p;
+        uint32_t start = from > first ? (uint32_t)(from - first) : 0;
+
+        for (uint32_t k = start; k < JOURNAL_SEG_RECORDS; k++) {
+            if (!journal_slot_valid(recs[k])) break;
+            fn(first + k, recs[k].ev);
+            next = first + k + 1;
+        }
+        munmap(p, JOURNAL_SEG_BYTES);
+    }
+    return next;
+}
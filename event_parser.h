@@ -0,0 +1,177 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <string_view>
+
+#include "event_record.h"
+
+/*
+   Streaming parser for the STM32 text protocol:
+
+       EVENT:2G,LAT:28.6141,LON:77.2092,DATE:17-10-2026,TIME:10:00:00\r\n
+
+   TCP is a byte stream, so a recv() may hold half a line or several
+   lines. LineFramer keeps the per-connection bytes and hands out one
+   complete line at a time as a view into its own storage; nothing is
+   allocated per message. Binary (v2) boards use the same buffer via
+   data()/size()/consume().
+*/
+
+#define LINE_BUF_SIZE   1024    // longest line we accept, incl. CRLF
+
+class LineFramer {
+public:
+    /* where the next recv() should land */
+    char* write_ptr()
+    {
+        if (rd_ == wr_) rd_ = wr_ = 0;          // fully drained: rewind
+        else if (wr_ == sizeof(buf_)) compact();
+        return buf_ + wr_;
+    }
+
+    size_t write_space() const { return sizeof(buf_) - wr_; }
+
+    void commit(size_t n) { wr_ += n; }
+
+    /* raw access for fixed-size binary frames */
+    const char* data() const { return buf_ + rd_; }
+    size_t      size() const { return wr_ - rd_; }
+    void        consume(size_t n) { rd_ += n; }
+
+    /*
+       Next complete line without its CR/LF. The view stays valid until
+       the next write_ptr() call.
+    */
+    bool next_line(std::string_view& line)
+    {
+        while (rd_ < wr_) {
+            const char* base = buf_ + rd_;
+            const char* nl = (const char*)memchr(base, '\n', wr_ - rd_);
+
+            if (!nl) {
+                /* a full buffer with no newline can never frame: drop it */
+                if (rd_ == 0 && wr_ == sizeof(buf_)) {
+                    overflows_++;
+                    rd_ = wr_ = 0;
+                }
+                return false;
+            }
+
+            size_t len = nl - base;
+            rd_ += len + 1;
+            if (len && base[len - 1] == '\r') len--;
+            if (!len) continue;                 // blank line
+
+            line = std::string_view(base, len);
+            return true;
+        }
+        return false;
+    }
+
+    uint64_t overflows() const { return overflows_; }
+
+private:
+    void compact()
+    {
+        memmove(buf_, buf_ + rd_, wr_ - rd_);
+        wr_ -= rd_;
+        rd_ = 0;
+    }
+
+    char     buf_[LINE_BUF_SIZE];
+    uint32_t rd_ = 0;
+    uint32_t wr_ = 0;
+    uint64_t overflows_ = 0;
+};
+
+/* Raw field views into one framed line */
+struct EventFields {
+    std::string_view event, lat, lon, date, time;
+};
+
+inline bool split_event_fields(std::string_view line, EventFields& f)
+{
+    f = EventFields{};
+
+    while (!line.empty()) {
+        size_t comma = line.find(',');
+        std::string_view kv = line.substr(0, comma);
+        line = comma == std::string_view::npos ? std::string_view{}
+                                               : line.substr(comma + 1);
+
+        size_t colon = kv.find(':');
+        if (colon == std::string_view::npos) continue;
+
+        std::string_view k = kv.substr(0, colon);
+        std::string_view v = kv.substr(colon + 1);
+
+        if      (k == "EVENT") f.event = v;
+        else if (k == "LAT")   f.lat   = v;
+        else if (k == "LON")   f.lon   = v;
+        else if (k == "DATE")  f.date  = v;
+        else if (k == "TIME")  f.time  = v;
+    }
+    return !f.event.empty();
+}
+
+namespace event_parser_detail {
+
+template <typename T>
+inline bool to_num(std::string_view s, T& out)
+{
+    auto r = std::from_chars(s.data(), s.data() + s.size(), out);
+    return r.ec == std::errc() && r.ptr == s.data() + s.size();
+}
+
+/* "a<sep>b<sep>c" → three integers */
+inline bool split3(std::string_view s, char sep, int& a, int& b, int& c)
+{
+    size_t p1 = s.find(sep);
+    if (p1 == std::string_view::npos) return false;
+    size_t p2 = s.find(sep, p1 + 1);
+    if (p2 == std::string_view::npos) return false;
+
+    return to_num(s.substr(0, p1), a) &&
+           to_num(s.substr(p1 + 1, p2 - p1 - 1), b) &&
+           to_num(s.substr(p2 + 1), c);
+}
+
+} // namespace event_parser_detail
+
+/*
+   Parse one framed line into a typed record. Returns false only if the
+   line carries no EVENT tag; missing or "NA" position fields just leave
+   has_fix = 0.
+*/
+inline bool parse_event(std::string_view line, EventRecord& r)
+{
+    using namespace event_parser_detail;
+
+    EventFields f;
+    if (!split_event_fields(line, f)) return false;
+
+    memset(&r, 0, sizeof(r));
+    memcpy(r.event, f.event.data(), std::min(f.event.size(), sizeof(r.event) - 1));
+
+    if (!to_num(f.lat, r.lat) || !to_num(f.lon, r.lon))
+        return true;
+
+    int d, mo, y, h, mi, s;
+    if (split3(f.date, '-', d, mo, y) && split3(f.time, ':', h, mi, s)) {
+        /* firmware prints "20%02d" with a 4-digit year → "202026" */
+        if (y > 9999) y %= 10000;
+
+        r.day  = d;  r.month = mo; r.year = y;
+        r.hour = h;  r.min   = mi; r.sec  = s;
+
+        if (mo >= 1 && mo <= 12 && d >= 1)
+            r.epoch = (uint32_t)(days_from_civil(y, mo, d) * 86400 +
+                                 h * 3600 + mi * 60 + s - IST_OFFSET_S);
+    }
+
+    r.has_fix = 1;
+    return true;
+}
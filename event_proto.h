@@ -0,0 +1,67 @@
+#ifndef EVENT_PROTO_H
+#define EVENT_PROTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+   STM32 → server binary event frame (protocol v2).
+
+   Fixed 32 bytes, little-endian (both Cortex-M4 and x86 are LE, so the
+   struct is sent as-is). The first byte is never printable ASCII, which
+   is how the server tells a v2 board from a legacy text board that
+   starts every line with "EVENT:".
+*/
+
+#define EVENT_V2_MAGIC      0x52A5      /* bytes A5 52 on the wire */
+#define EVENT_V2_VERSION    2
+
+#define EVENT_V2_FLAG_FIX   0x01        /* lat/lon/epoch are valid */
+
+#define EVENT_V2_TYPE_2G    1
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  flags;
+    uint32_t device_id;
+    uint32_t seq;           /* per-boot, increments per event */
+    int32_t  lat_e7;        /* degrees * 1e7 */
+    int32_t  lon_e7;
+    uint32_t epoch;         /* GPS UTC seconds since 1970 */
+    uint16_t peak_mg;       /* largest axis reading, milli-g */
+    uint8_t  type;          /* EVENT_V2_TYPE_* */
+    uint8_t  reserved[3];
+    uint16_t crc16;         /* CRC-16/CCITT-FALSE over all bytes above */
+} event_frame_v2_t;
+
+typedef char event_frame_v2_size_check[sizeof(event_frame_v2_t) == 32 ? 1 : -1];
+
+static inline uint16_t event_crc16(const uint8_t *p, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+
+    while (len--) {
+        crc ^= (uint16_t)(*p++) << 8;
+        for (int i = 0; i < 8; i++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+/* fill magic/version/crc once the payload fields are set */
+static inline void event_v2_seal(event_frame_v2_t *f)
+{
+    f->magic   = EVENT_V2_MAGIC;
+    f->version = EVENT_V2_VERSION;
+    f->crc16   = event_crc16((const uint8_t *)f, offsetof(event_frame_v2_t, crc16));
+}
+
+static inline int event_v2_valid(const event_frame_v2_t *f)
+{
+    return f->magic == EVENT_V2_MAGIC &&
+           f->version == EVENT_V2_VERSION &&
+           f->crc16 == event_crc16((const uint8_t *)f, offsetof(event_frame_v2_t, crc16));
+}
+
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+/*
+   Typed STM32 event, as decoded from the wire (text or binary v2).
+
+   Plain trivially-copyable struct so it can be copied into fixed-size
+   records without serialisation.
+*/
+struct EventRecord {
+    char     event[8];      // NUL-padded tag, e.g. "2G"
+    uint8_t  has_fix;       // 0 → lat/lon/date/time were "NA"
+    uint8_t  day;           // date/time are IST, as shown on the board
+    uint8_t  month;
+    uint8_t  hour;
+    uint8_t  min;
+    uint8_t  sec;
+    uint16_t year;
+    uint16_t peak_mg;       // 0 when the board does not report it
+    uint32_t device_id;     // 0 for legacy text boards
+    uint32_t seq;           // board sequence number (v2 only)
+    uint32_t epoch;         // UTC seconds, 0 without a fix
+    uint32_t rx_time;       // server UTC seconds at ingest
+    double   lat;
+    double   lon;
+
+    bool is(const char* tag) const
+    {
+        return strncmp(event, tag, sizeof(event)) == 0;
+    }
+};
+
+#define IST_OFFSET_S    (5 * 3600 + 30 * 60)
+
+/* days since 1970-01-01 for a proleptic Gregorian date */
+inline int64_t days_from_civil(int y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    const int64_t  era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+/* fill the IST date/time fields from a UTC epoch */
+inline void set_civil_from_epoch(EventRecord& r, uint32_t epoch)
+{
+    int64_t t    = (int64_t)epoch + IST_OFFSET_S;
+    int64_t z    = t / 86400 + 719468;
+    int64_t secs = t % 86400;
+
+    const int64_t  era = z / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp  = (5 * doy + 2) / 153;
+    const unsigned d   = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m   = mp < 10 ? mp + 3 : mp - 9;
+
+    r.year  = (uint16_t)(yoe + era * 400 + (m <= 2));
+    r.month = (uint8_t)m;
+    r.day   = (uint8_t)d;
+    r.hour  = (uint8_t)(secs / 3600);
+    r.min   = (uint8_t)(secs / 60 % 60);
+    r.sec   = (uint8_t)(secs % 60);
+}
@@ -1,115 +1,48 @@
-#include <arpa/inet.h>
-#include <unistd.h>
-#include <iostream>
+#include <csignal>
 #include <cstring>
-#include <fstream>
-#include <algorithm>
-/* ================= CONFIG ================= */
-#define TCP_PORT        5000
-#define ESP32_IP        "192.168.1.100"
-#define ESP32_CMD_PORT  9100
-
-
-std::string clean(const std::string& s)
-{
-    std::string out = s;
-    out.erase(std::remove(out.begin(), out.end(), '\n'), out.end());
-    out.erase(std::remove(out.begin(), out.end(), '\r'), out.end());
-    return out;
-}
-
-/* ================= HELPERS ================= */
-std::string getValue(const std::string& s, const std::string& k)
-{
-    size_t p = s.find(k + ":");
-    if (p == std::string::npos) return "NA";
-
-    p += k.size() + 1;
-    size_t e = s.find(",", p);
-    if (e == std::string::npos) e = s.size();
-
-    return s.substr(p, e - p);
-}
-
-void write_stm32_json(const std::string& event,
-                      const std::string& lat,
-                      const std::string& lon,
-                      const std::string& date,
-                      const std::string& time)
-{
-    std::ofstream f("data/stm32.json");
-    if (!f.is_open()) return;
-
-    f << "{\n";
-    f << "  \"event\": \"" << event << "\",\n";
-    f << "  \"lat\": \""   << lat   << "\",\n";
-    f << "  \"lon\": \""   << lon   << "\",\n";
-    f << "  \"date\": \""  << date  << "\",\n";
-    f << "  \"time\": \""  << time  << "\"\n";
-    f << "}\n";
+#include <cstdlib>
+#include <iostream>
 
-    f.close();
-}
+#include "event_ingest.h"
 
 /* ================= MAIN ================= */
-int main()
+int main(int argc, char* argv[])
 {
-    /* ---------- TCP SERVER (STM32) ---------- */
-    int tcp_sock = socket(AF_INET, SOCK_STREAM, 0);
-
-    sockaddr_in srv{};
-    srv.sin_family = AF_INET;
-    srv.sin_port   = htons(TCP_PORT);
-    srv.sin_addr.s_addr = INADDR_ANY;
-
-    bind(tcp_sock, (sockaddr*)&srv, sizeof(srv));
-    listen(tcp_sock, 1);
-
-    std::cout << "[SERVER] Waiting for STM32...\n";
-    int client = accept(tcp_sock, nullptr, nullptr);
-    std::cout << "[SERVER] STM32 connected\n";
-
-    /* ---------- UDP SOCKET (ESP32) ---------- */
-    int udp = socket(AF_INET, SOCK_DGRAM, 0);
-
-    sockaddr_in esp{};
-    esp.sin_family = AF_INET;
-    esp.sin_port   = htons(ESP32_CMD_PORT);
-    inet_pton(AF_INET, ESP32_IP, &esp.sin_addr);
-
-    /* ---------- MAIN LOOP ---------- */
-    while (1) {
-        char buf[256]{};
-
-        int n = recv(client, buf, sizeof(buf) - 1, 0);
-        if (n <= 0) continue;
-
-        buf[n] = 0;
-        std::string rx(buf);
-
-        std::cout << "[SERVER] RX: " << rx << std::endl;
-
-std::string event = clean(getValue(rx, "EVENT"));
-std::string lat   = clean(getValue(rx, "LAT"));
-std::string lon   = clean(getValue(rx, "LON"));
-std::string date  = clean(getValue(rx, "DATE"));
-std::string time  = clean(getValue(rx, "TIME"));
-
-
-        /* WRITE LIVE STM32 DATA */
-        write_stm32_json(event, lat, lon, date, time);
-
-        /* 2G DETECT → ESP32 IMAGE CAPTURE */
-        if (event == "2G") {
-            sendto(udp, "CAPTURE:1", 9, 0,
-                   (sockaddr*)&esp, sizeof(esp));
-
-            std::cout << "[SERVER] CMD → ESP32: CAPTURE\n";
+    IngestOptions o;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--port") && i + 1 < argc)
+            o.port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--esp32") && i + 1 < argc)
+            o.esp_ip = argv[++i];
+        else if (!strcmp(argv[i], "--idle-timeout") && i + 1 < argc)
+            o.idle_timeout_ms = (uint32_t)atoi(argv[++i]) * 1000;
+        else if (!strcmp(argv[i], "--json-files"))
+            o.json_files = true;
+        else if (!strcmp(argv[i], "--verbose"))
+            o.verbose = true;
+        else if (!strcmp(argv[i], "--journal-sync") && i + 1 < argc)
+            o.journal.sync_every = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--journal-sync-ms") && i + 1 < argc)
+            o.journal.sync_ms = (uint32_t)atoi(argv[++i]);
+        else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--port N] [--esp32 IP] [--idle-timeout SEC]"
+                         " [--journal-sync EVENTS] [--journal-sync-ms MS]"
+                         " [--json-files] [--verbose]\n";
+            return 1;
         }
     }
 
-    close(client);
-    close(tcp_sock);
-    close(udp);
+    signal(SIGPIPE, SIG_IGN);
+
+    /* ---------- LIVE STATE + METRICS (SHARED MEMORY) ---------- */
+    LiveState* live = live_state_open();
+    if (!live) return 1;
+    metrics_open();     // optional: counters are dropped if unavailable
+
+    static IngestServer s;
+    if (!ingest_open(s, o, live)) return 1;
+    ingest_run(s);
     return 0;
-} 
\ No newline at end of file
+}
@@ -0,0 +1,155 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "live_state.h"
+
+/*
+   Server-sent events for the dashboard (/api/stream).
+
+   One pump thread follows the live state rings and turns each new event
+   and image into a ready-to-send SSE frame exactly once; every
+   subscriber writes those same bytes. The last SSE_RING_SIZE frames are
+   kept, which is also what a reconnecting browser resumes from: a
+   frame's id is the position in both live rings after it
+   ("<events>.<images>"), and EventSource sends the last one back as
+   Last-Event-ID. A client whose id is no longer held (it was away too
+   long, or the dashboard restarted) gets a "resync" event and reloads
+   its state over the REST API.
+*/
+
+#define SSE_RING_SIZE       1024
+#define SSE_POLL_MS         20          // live ring poll interval
+#define SSE_KEEPALIVE_MS    15000       // comment line to keep proxies from timing out
+
+/* "id:", "event:", then one "data:" line per JSON line */
+inline std::string sse_frame(const char* id, const char* type, const std::string& json)
+{
+    std::string f = "id: " + std::string(id) + "\nevent: " + type + "\n";
+    size_t p = 0;
+    while (p < json.size()) {
+        size_t q = json.find('\n', p);
+        if (q == std::string::npos) q = json.size();
+        if (q > p) f += "data: " + json.substr(p, q - p) + "\n";
+        p = q + 1;
+    }
+    return f + "\n";
+}
+
+class SseBroadcast {
+public:
+    using Frame = std::shared_ptr<const std::string>;
+
+    void start(const LiveState* live)
+    {
+        events_ = live->events.head.load(std::memory_order_acquire);
+        images_ = live->images.head.load(std::memory_order_acquire);
+        ring_.resize(SSE_RING_SIZE);
+
+        std::thread([this, live] {
+            for (;;) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(SSE_POLL_MS));
+                pump(live);
+            }
+        }).detach();
+    }
+
+    /*
+       New subscriber: the seq of the first frame it should get. If
+       Last-Event-ID can't be honoured, greeting holds a resync frame.
+    */
+    uint64_t subscribe(const std::string& last_id, std::string& greeting) const
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        greeting = "retry: 2000\n\n";
+        if (last_id.empty()) return next_;
+
+        unsigned long long e, i;
+        if (sscanf(last_id.c_str(), "%llu.%llu", &e, &i) == 2) {
+            if (e == events_ && i == images_) return next_;
+            for (uint64_t s = oldest(); s < next_; s++) {
+                const Slot& f = ring_[s % SSE_RING_SIZE];
+                if (f.events == e && f.images == i) return s + 1;
+            }
+        }
+        greeting += resync();
+        return next_;
+    }
+
+    /*
+       Frames from seq on, waiting up to timeout_ms for the first one;
+       seq is advanced past them. A subscriber that fell a whole ring
+       behind gets a resync instead of the frames it missed.
+    */
+    void wait(uint64_t& seq, std::vector<Frame>& out, int timeout_ms) const
+    {
+        out.clear();
+        std::unique_lock<std::mutex> lk(mu_);
+        cv_.wait_for(lk, std::chrono::milliseconds(timeout_ms), [&] { return next_ > seq; });
+
+        if (seq < oldest()) {
+            out.push_back(std::make_shared<const std::string>(resync()));
+            seq = next_;
+            return;
+        }
+        for (; seq < next_; seq++) out.push_back(ring_[seq % SSE_RING_SIZE].text);
+    }
+
+private:
+    struct Slot {
+        uint64_t events = 0, images = 0;    // live ring positions after this frame
+        Frame    text;
+    };
+
+    void pump(const LiveState* live)
+    {
+        // serialise outside the lock, publish each frame under it
+        live->events.read_since(events_, [&](uint64_t k, const LiveEvent& e) {
+            publish(k + 1, images_, "stm32", event_json(e.ev));
+        });
+        live->images.read_since(images_, [&](uint64_t k, const LiveImage& im) {
+            publish(events_, k + 1, "image", image_json(im));
+        });
+    }
+
+    void publish(uint64_t events, uint64_t images, const char* type, const std::string& json)
+    {
+        char id[48];
+        snprintf(id, sizeof(id), "%llu.%llu", (unsigned long long)events, (unsigned long long)images);
+        Frame text = std::make_shared<const std::string>(sse_frame(id, type, json));
+
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            Slot& s = ring_[next_ % SSE_RING_SIZE];
+            s.events = events_ = events;
+            s.images = images_ = images;
+            s.text   = std::move(text);
+            next_++;
+        }
+        cv_.notify_all();
+    }
+
+    /* caller holds mu_ */
+    uint64_t oldest() const { return next_ > SSE_RING_SIZE ? next_ - SSE_RING_SIZE : 0; }
+
+    std::string resync() const
+    {
+        char id[48];
+        snprintf(id, sizeof(id), "%llu.%llu", (unsigned long long)events_, (unsigned long long)images_);
+        return sse_frame(id, "resync", "{}");
+    }
+
+    mutable std::mutex              mu_;
+    mutable std::condition_variable cv_;
+    std::vector<Slot>               ring_;
+    uint64_t                        next_   = 0;    // seq of the next frame
+    uint64_t                        events_ = 0;    // live ring positions consumed
+    uint64_t                        images_ = 0;
+};
@@ -0,0 +1,215 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include "image_fec.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FEC_X86 1
+#endif
+
+/*
+   Server-side Reed-Solomon kernels for image_fec.h.
+
+   All the work is dst ^= c * src over a chunk. The SIMD versions use
+   the split-nibble trick: c * x = c * (x & 15) ^ c * (x & 0xF0), each
+   half a 16-entry table lookup done with pshufb (16 bytes per
+   instruction with SSSE3, 32 with AVX2). The best kernel is picked at
+   run time, so the binary needs no -mavx2 and still runs anywhere.
+*/
+
+enum FecKernel { FEC_SCALAR, FEC_SSSE3, FEC_AVX2 };
+
+struct FecTables {
+    image_gf_t gf;
+    uint8_t    mul[256][256];
+    uint8_t    lo[256][16];     // c * x      for x < 16
+    uint8_t    hi[256][16];     // c * (x<<4) for x < 16
+};
+
+inline const FecTables& fec_tables()
+{
+    static const FecTables* t = [] {
+        FecTables* t = new FecTables;
+        image_gf_init(&t->gf);
+        for (int c = 0; c < 256; c++) {
+            for (int x = 0; x < 256; x++) t->mul[c][x] = image_gf_mul(&t->gf, c, x);
+            for (int x = 0; x < 16; x++) {
+                t->lo[c][x] = t->mul[c][x];
+                t->hi[c][x] = t->mul[c][x << 4];
+            }
+        }
+        return t;
+    }();
+    return *t;
+}
+
+/* ================= REGION KERNELS ================= */
+inline void fec_mul_add_scalar(uint8_t* dst, const uint8_t* src, uint8_t c, size_t n)
+{
+    const uint8_t* row = fec_tables().mul[c];
+    for (size_t i = 0; i < n; i++) dst[i] ^= row[src[i]];
+}
+
+#ifdef FEC_X86
+__attribute__((target("ssse3")))
+inline void fec_mul_add_ssse3(uint8_t* dst, const uint8_t* src, uint8_t c, size_t n)
+{
+    const FecTables& t = fec_tables();
+    __m128i lo   = _mm_loadu_si128((const __m128i*)t.lo[c]);
+    __m128i hi   = _mm_loadu_si128((const __m128i*)t.hi[c]);
+    __m128i mask = _mm_set1_epi8(0x0F);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i l = _mm_shuffle_epi8(lo, _mm_and_si128(s, mask));
+        __m128i h = _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(s, 4), mask));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(d, _mm_xor_si128(l, h)));
+    }
+    for (; i < n; i++) dst[i] ^= t.mul[c][src[i]];
+}
+
+__attribute__((target("avx2")))
+inline void fec_mul_add_avx2(uint8_t* dst, const uint8_t* src, uint8_t c, size_t n)
+{
+    const FecTables& t = fec_tables();
+    __m256i lo   = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)t.lo[c]));
+    __m256i hi   = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)t.hi[c]));
+    __m256i mask = _mm256_set1_epi8(0x0F);
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i l = _mm256_shuffle_epi8(lo, _mm256_and_si256(s, mask));
+        __m256i h = _mm256_shuffle_epi8(hi, _mm256_and_si256(_mm256_srli_epi16(s, 4), mask));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(d, _mm256_xor_si256(l, h)));
+    }
+    for (; i < n; i++) dst[i] ^= t.mul[c][src[i]];
+}
+#endif
+
+inline FecKernel fec_best_kernel()
+{
+#ifdef FEC_X86
+    if (__builtin_cpu_supports("avx2"))  return FEC_AVX2;
+    if (__builtin_cpu_supports("ssse3")) return FEC_SSSE3;
+#endif
+    return FEC_SCALAR;
+}
+
+inline const char* fec_kernel_name(FecKernel k)
+{
+    return k == FEC_AVX2 ? "avx2" : k == FEC_SSSE3 ? "ssse3" : "scalar";
+}
+
+/* ================= CODEC ================= */
+class FecCodec {
+public:
+    explicit FecCodec(FecKernel k = fec_best_kernel()) : gf_(&fec_tables().gf)
+    {
+        mul_add_ = fec_mul_add_scalar;
+#ifdef FEC_X86
+        if (k == FEC_AVX2)  mul_add_ = fec_mul_add_avx2;
+        if (k == FEC_SSSE3) mul_add_ = fec_mul_add_ssse3;
+#endif
+    }
+
+    void mul_add(uint8_t* dst, const uint8_t* src, uint8_t c, size_t n) const
+    {
+        if (c == 0) return;
+        mul_add_(dst, src, c, n);
+    }
+
+    /* parity[r] = sum_j C[r][j] * data[j], each n bytes */
+    void encode(const uint8_t* const* data, unsigned k, unsigned m,
+                uint8_t* const* parity, size_t n) const
+    {
+        for (unsigned r = 0; r < m; r++) {
+            memset(parity[r], 0, n);
+            for (unsigned j = 0; j < k; j++)
+                mul_add(parity[r], data[j], image_fec_coef(gf_, r, j, m), n);
+        }
+    }
+
+    /*
+       Rebuild the missing data chunks of one block in place. have_data /
+       have_parity flag what arrived; parity buffers are used as scratch.
+       Returns the number of chunks rebuilt, or -1 if too many are lost.
+    */
+    int decode(uint8_t* const* data, const bool* have_data, unsigned k,
+               uint8_t* const* parity, const bool* have_parity, unsigned m, size_t n) const
+    {
+        unsigned lost[IMAGE_FEC_MAX_M], rows[IMAGE_FEC_MAX_M], e = 0, nr = 0;
+
+        for (unsigned j = 0; j < k; j++)
+            if (!have_data[j]) {
+                if (e == m) return -1;
+                lost[e++] = j;
+            }
+        if (e == 0) return 0;
+        for (unsigned r = 0; r < m && nr < e; r++)
+            if (have_parity[r]) rows[nr++] = r;
+        if (nr < e) return -1;
+
+        // S_t = P_rows[t] minus the contribution of the chunks we have
+        for (unsigned t = 0; t < e; t++)
+            for (unsigned j = 0; j < k; j++)
+                if (have_data[j])
+                    mul_add(parity[rows[t]], data[j], image_fec_coef(gf_, rows[t], j, m), n);
+
+        // invert the e x e Cauchy submatrix A[t][i] = C[rows[t]][lost[i]]
+        uint8_t a[IMAGE_FEC_MAX_M][IMAGE_FEC_MAX_M], inv[IMAGE_FEC_MAX_M][IMAGE_FEC_MAX_M];
+        for (unsigned t = 0; t < e; t++)
+            for (unsigned i = 0; i < e; i++) {
+                a[t][i]   = image_fec_coef(gf_, rows[t], lost[i], m);
+                inv[t][i] = t == i;
+            }
+        if (!invert(a, inv, e)) return -1;
+
+        // D_lost[i] = sum_t inv[i][t] * S_t
+        for (unsigned i = 0; i < e; i++) {
+            memset(data[lost[i]], 0, n);
+            for (unsigned t = 0; t < e; t++)
+                mul_add(data[lost[i]], parity[rows[t]], inv[i][t], n);
+        }
+        return (int)e;
+    }
+
+private:
+    bool invert(uint8_t a[][IMAGE_FEC_MAX_M], uint8_t inv[][IMAGE_FEC_MAX_M], unsigned e) const
+    {
+        for (unsigned col = 0; col < e; col++) {
+            unsigned p = col;
+            while (p < e && !a[p][col]) p++;
+            if (p == e) return false;
+            if (p != col)
+                for (unsigned i = 0; i < e; i++) {
+                    std::swap(a[p][i], a[col][i]);
+                    std::swap(inv[p][i], inv[col][i]);
+                }
+
+            uint8_t s = image_gf_inv(gf_, a[col][col]);
+            for (unsigned i = 0; i < e; i++) {
+                a[col][i]   = image_gf_mul(gf_, a[col][i], s);
+                inv[col][i] = image_gf_mul(gf_, inv[col][i], s);
+            }
+            for (unsigned r = 0; r < e; r++) {
+                uint8_t f = a[r][col];
+                if (r == col || !f) continue;
+                for (unsigned i = 0; i < e; i++) {
+                    a[r][i]   ^= image_gf_mul(gf_, a[col][i], f);
+                    inv[r][i] ^= image_gf_mul(gf_, inv[col][i], f);
+                }
+            }
+        }
+        return true;
+    }
+
+    const image_gf_t* gf_;
+    void (*mul_add_)(uint8_t*, const uint8_t*, uint8_t, size_t);
+};
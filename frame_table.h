@@ -0,0 +1,351 @@
+#pragma once
+#include <time.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "metrics.h"
+#include "image_proto.h"
+
+/*
+   Image frames being reassembled by one receiver worker.
+
+   - memory   : payload slabs come from a capped pool; when it is empty
+                the least recently active incomplete frame is evicted
+   - deadline : a frame idle for NACK_IDLE_MS with chunks missing gets
+                a NACK (up to NACK_MAX_TRIES, NACK_RETRY_MS apart); it
+                must complete within FRAME_TIMEOUT_MS of its first chunk.
+                The next deadline of each frame sits in a timer wheel of
+                FRAME_WHEEL_SLOTS ticks, so expiry is O(expired)
+   - lookup   : open-addressed hash on sender + frame_id, no allocation
+                after init()
+
+   A completed frame keeps its (slab-less) entry until its deadline so
+   late duplicate chunks are recognised instead of starting a new frame.
+*/
+
+#define FRAME_SLAB_BYTES    (512 * 1024)    // largest frame we reassemble
+#define FRAME_MAX_CHUNKS    (FRAME_SLAB_BYTES / IMAGE_MAX_PAYLOAD)
+
+#define FRAME_TIMEOUT_MS    3000
+#define FRAME_WHEEL_TICK_MS 20
+#define FRAME_WHEEL_SLOTS   256             // must span FRAME_TIMEOUT_MS
+
+#define NACK_IDLE_MS        60              // quiet time before asking for gaps
+#define NACK_RETRY_MS       150
+#define NACK_MAX_TRIES      4
+
+static_assert(FRAME_MAX_CHUNKS <= IMAGE_NACK_MAX_BITMAP * 8,
+              "a NACK must be able to name every chunk of a frame");
+static_assert(FRAME_WHEEL_SLOTS * FRAME_WHEEL_TICK_MS > FRAME_TIMEOUT_MS,
+              "timer wheel too short for the frame timeout");
+
+inline uint64_t frame_now_ms()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+struct FrameBuffer {
+    uint64_t key;
+    bool     used;
+    bool     done;                  // completed, kept to absorb late dups
+    uint16_t total;
+    uint16_t received;
+    uint32_t len;                   // known once the last chunk arrives
+    uint32_t event_id;              // triggering event, from the chunk header
+    uint8_t  fec_k;                 // FEC block shape, 0 until a parity
+    uint8_t  fec_m;                 //   chunk has been seen
+    uint16_t fec_last_len;
+    uint64_t first_ns;
+    uint8_t* data;                  // FRAME_SLAB_BYTES from the pool
+    uint64_t have[(FRAME_MAX_CHUNKS + 63) / 64];
+
+    uint64_t deadline_tick;         // next wheel action
+    uint64_t expire_tick;           // hard limit, FRAME_TIMEOUT_MS after start
+    uint8_t  nacks;
+    int32_t  lru_prev, lru_next;    // most recently active at lru head
+    int32_t  wheel_prev, wheel_next;
+
+    bool has(unsigned k) const { return (have[k >> 6] >> (k & 63)) & 1; }
+
+    bool test_and_set(uint16_t k)
+    {
+        uint64_t bit = 1ull << (k & 63);
+        if (have[k >> 6] & bit) return true;
+        have[k >> 6] |= bit;
+        return false;
+    }
+};
+
+/* fixed number of slabs, allocated on first use and then recycled */
+class FramePool {
+public:
+    void init(size_t max_slabs) { max_ = max_slabs; }
+
+    uint8_t* get()
+    {
+        if (!free_.empty()) {
+            uint8_t* p = free_.back();
+            free_.pop_back();
+            return p;
+        }
+        if (allocated_ == max_) return nullptr;
+
+        uint8_t* p = (uint8_t*)aligned_alloc(4096, FRAME_SLAB_BYTES);
+        if (p) {
+            allocated_++;
+            metric_gauge_add(G_FRAME_MEMORY, FRAME_SLAB_BYTES);
+        }
+        return p;
+    }
+
+    void put(uint8_t* p) { free_.push_back(p); }
+
+private:
+    std::vector<uint8_t*> free_;
+    size_t allocated_ = 0;
+    size_t max_ = 0;
+};
+
+class FrameTable {
+public:
+    void init(size_t max_slabs)
+    {
+        pool_.init(max_slabs);
+
+        // completed entries outlive their slab, so allow twice as many
+        entries_.assign(max_slabs * 2, FrameBuffer{});
+        for (size_t i = 0; i < entries_.size(); i++)
+            free_.push_back((int32_t)(entries_.size() - 1 - i));
+
+        size_t n = 1;
+        while (n < entries_.size() * 2) n <<= 1;
+        index_.assign(n, -1);
+
+        wheel_.assign(FRAME_WHEEL_SLOTS, -1);
+        tick_ = frame_now_ms() / FRAME_WHEEL_TICK_MS;
+    }
+
+    FrameBuffer* find(uint64_t key)
+    {
+        for (size_t h = hash(key);; h = (h + 1) & (index_.size() - 1)) {
+            int32_t i = index_[h];
+            if (i < 0) return nullptr;
+            if (entries_[i].key == key) {
+                lru_unlink(i);
+                lru_push(i);
+                return &entries_[i];
+            }
+        }
+    }
+
+    /* start a new frame; evicts as needed, nullptr only if no slab at all */
+    FrameBuffer* insert(uint64_t key, uint16_t total)
+    {
+        if (free_.empty()) evict(false);
+
+        uint8_t* data = pool_.get();
+        while (!data && evict(true)) data = pool_.get();
+        if (!data || free_.empty()) {
+            if (data) pool_.put(data);
+            return nullptr;
+        }
+
+        int32_t i = free_.back();
+        free_.pop_back();
+
+        FrameBuffer& f = entries_[i];
+        memset(&f, 0, sizeof(f));
+        f.key      = key;
+        f.used     = true;
+        f.total    = total;
+        f.first_ns = metrics_now_ns();
+        f.data     = data;
+
+        size_t h = hash(key);
+        while (index_[h] >= 0) h = (h + 1) & (index_.size() - 1);
+        index_[h] = i;
+
+        uint64_t now = frame_now_ms();
+        f.expire_tick = ticks(now + FRAME_TIMEOUT_MS);
+
+        lru_push(i);
+        wheel_add(i, ticks(now + NACK_IDLE_MS));
+        metric_gauge_add(G_FRAMES_PENDING, 1);
+        return &f;
+    }
+
+    /* a chunk arrived: push the NACK deadline back */
+    void activity(FrameBuffer* f)
+    {
+        int32_t i = (int32_t)(f - entries_.data());
+        wheel_unlink(i);
+        wheel_add(i, std::min(ticks(frame_now_ms() + NACK_IDLE_MS), f->expire_tick));
+    }
+
+    /*
+       Frame finished: the caller takes the slab (hand it back with
+       put_slab() once written out), the key stays until its deadline.
+    */
+    uint8_t* complete(FrameBuffer* f)
+    {
+        int32_t i = (int32_t)(f - entries_.data());
+        uint8_t* slab = f->data;
+        f->data = nullptr;
+        f->done = true;
+        wheel_unlink(i);
+        wheel_add(i, f->expire_tick);
+        metric_gauge_add(G_FRAMES_PENDING, -1);
+        return slab;
+    }
+
+    void put_slab(uint8_t* slab) { pool_.put(slab); }
+
+    /* abandon an incomplete frame (frame_id reused) */
+    void drop(FrameBuffer* f)
+    {
+        account_lost(*f);
+        metric_inc(C_FRAMES_DROPPED);
+        remove((int32_t)(f - entries_.data()));
+    }
+
+    /*
+       Run every deadline that has passed: nack(const FrameBuffer&) for
+       stalled frames that still have tries left, expiry for the rest.
+    */
+    template <typename F>
+    void advance(uint64_t now_ms, F&& nack)
+    {
+        uint64_t now = now_ms / FRAME_WHEEL_TICK_MS;
+        if (now - tick_ > FRAME_WHEEL_SLOTS) tick_ = now - FRAME_WHEEL_SLOTS;
+
+        while (tick_ < now) {
+            tick_++;
+            int32_t i = wheel_[tick_ % FRAME_WHEEL_SLOTS];
+            while (i >= 0) {
+                FrameBuffer& f = entries_[i];
+                int32_t next = f.wheel_next;
+                if (f.deadline_tick <= tick_) {
+                    if (!f.done && f.nacks < NACK_MAX_TRIES && tick_ < f.expire_tick) {
+                        nack(f);
+                        f.nacks++;
+                        wheel_unlink(i);
+                        wheel_add(i, std::min(tick_ + ticks(NACK_RETRY_MS), f.expire_tick));
+                    } else {
+                        if (!f.done) {
+                            account_lost(f);
+                            metric_inc(C_FRAMES_EXPIRED);
+                        }
+                        remove(i);
+                    }
+                }
+                i = next;
+            }
+        }
+    }
+
+private:
+    static uint64_t ticks(uint64_t ms)
+    {
+        return (ms + FRAME_WHEEL_TICK_MS - 1) / FRAME_WHEEL_TICK_MS;
+    }
+
+    size_t hash(uint64_t key) const
+    {
+        return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & (index_.size() - 1);
+    }
+
+    void account_lost(const FrameBuffer& f)
+    {
+        metric_inc(C_CHUNKS_LOST, f.total - f.received);
+        metric_gauge_add(G_FRAMES_PENDING, -1);
+    }
+
+    /* least recently active victim; need_slab skips completed entries */
+    bool evict(bool need_slab)
+    {
+        for (int32_t i = lru_tail_; i >= 0; i = entries_[i].lru_prev) {
+            if (need_slab && entries_[i].done) continue;
+            if (!entries_[i].done) {
+                account_lost(entries_[i]);
+                metric_inc(C_FRAMES_EVICTED);
+            }
+            remove(i);
+            return true;
+        }
+        return false;
+    }
+
+    void remove(int32_t i)
+    {
+        FrameBuffer& f = entries_[i];
+        if (f.data) pool_.put(f.data);
+
+        // backward-shift delete keeps probe chains intact without tombstones
+        size_t mask = index_.size() - 1;
+        size_t h = hash(f.key);
+        while (index_[h] != i) h = (h + 1) & mask;
+        for (size_t j = (h + 1) & mask; index_[j] >= 0; j = (j + 1) & mask) {
+            size_t home = hash(entries_[index_[j]].key);
+            if (((j - home) & mask) >= ((j - h) & mask)) {
+                index_[h] = index_[j];
+                h = j;
+            }
+        }
+        index_[h] = -1;
+
+        lru_unlink(i);
+        wheel_unlink(i);
+        f.used = false;
+        f.data = nullptr;
+        free_.push_back(i);
+    }
+
+    void lru_push(int32_t i)
+    {
+        entries_[i].lru_prev = -1;
+        entries_[i].lru_next = lru_head_;
+        if (lru_head_ >= 0) entries_[lru_head_].lru_prev = i;
+        lru_head_ = i;
+        if (lru_tail_ < 0) lru_tail_ = i;
+    }
+
+    void lru_unlink(int32_t i)
+    {
+        FrameBuffer& f = entries_[i];
+        if (f.lru_prev >= 0) entries_[f.lru_prev].lru_next = f.lru_next; else lru_head_ = f.lru_next;
+        if (f.lru_next >= 0) entries_[f.lru_next].lru_prev = f.lru_prev; else lru_tail_ = f.lru_prev;
+    }
+
+    void wheel_add(int32_t i, uint64_t deadline)
+    {
+        FrameBuffer& f = entries_[i];
+        int32_t& head = wheel_[deadline % FRAME_WHEEL_SLOTS];
+        f.deadline_tick = deadline;
+        f.wheel_prev = -1;
+        f.wheel_next = head;
+        if (head >= 0) entries_[head].wheel_prev = i;
+        head = i;
+    }
+
+    void wheel_unlink(int32_t i)
+    {
+        FrameBuffer& f = entries_[i];
+        if (f.wheel_prev >= 0) entries_[f.wheel_prev].wheel_next = f.wheel_next;
+        else wheel_[f.deadline_tick % FRAME_WHEEL_SLOTS] = f.wheel_next;
+        if (f.wheel_next >= 0) entries_[f.wheel_next].wheel_prev = f.wheel_prev;
+    }
+
+    FramePool                pool_;
+    std::vector<FrameBuffer> entries_;
+    std::vector<int32_t>     free_;
+    std::vector<int32_t>     index_;        // hash slot -> entry, -1 empty
+    std::vector<int32_t>     wheel_;        // tick % slots -> first entry
+    int32_t                  lru_head_ = -1;
+    int32_t                  lru_tail_ = -1;
+    uint64_t                 tick_ = 0;
+};
@@ -12,6 +12,9 @@ static uint8_t gps_idx = 0;
 
 static float gps_latitude = 0.0f;
 static float gps_longitude = 0.0f;
+static int32_t gps_lat_e7 = 0;
+static int32_t gps_lon_e7 = 0;
+static uint32_t gps_epoch = 0;   // UTC seconds since 1970
 static uint8_t gps_fix = 0;
 
 // DATE & TIME (IST) 
@@ -33,6 +36,42 @@ static float nmea_to_decimal(char *val, char dir)
     return dec;
 }
 
+// "ddmm.mmmmm" → degrees * 1e7, integer only (no float rounding)
+static int32_t nmea_to_e7(const char *val, char dir)
+{
+    uint32_t whole = 0, frac = 0, scale = 1;
+
+    while (*val >= '0' && *val <= '9')
+        whole = whole * 10 + (*val++ - '0');
+
+    if (*val == '.')
+    {
+        val++;
+        while (*val >= '0' && *val <= '9' && scale < 100000)
+        {
+            frac = frac * 10 + (*val++ - '0');
+            scale *= 10;
+        }
+    }
+
+    uint32_t deg    = whole / 100;
+    uint32_t min_e5 = (whole % 100) * 100000 + frac * (100000 / scale);
+    int32_t  e7     = (int32_t)(deg * 10000000u + (min_e5 * 10u + 3u) / 6u);
+
+    return (dir == 'S' || dir == 'W') ? -e7 : e7;
+}
+
+// days since 1970-01-01
+static int32_t days_from_civil(int32_t y, uint32_t m, uint32_t d)
+{
+    y -= m <= 2;
+    int32_t  era = (y >= 0 ? y : y - 399) / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
 static void gps_parse_gprmc(char *s)
 {
     char *tok;
@@ -72,6 +111,12 @@ static void gps_parse_gprmc(char *s)
 
     gps_latitude  = nmea_to_decimal(lat, lat_dir[0]);
     gps_longitude = nmea_to_decimal(lon, lon_dir[0]);
+    gps_lat_e7    = nmea_to_e7(lat, lat_dir[0]);
+    gps_lon_e7    = nmea_to_e7(lon, lon_dir[0]);
+
+    // UTC epoch, before the display fields are shifted to IST
+    gps_epoch = (uint32_t)days_from_civil(gps_y, gps_mo, gps_d) * 86400u
+              + gps_h * 3600u + gps_m * 60u + gps_s;
 
     // UTC → IST (+5:30) 
     gps_h += 5;
@@ -121,6 +166,9 @@ void gps_process(void)
 uint8_t gps_fix_available(void) { return gps_fix; }
 float gps_get_lat(void) { return gps_latitude; }
 float gps_get_lon(void) { return gps_longitude; }
+int32_t gps_get_lat_e7(void) { return gps_lat_e7; }
+int32_t gps_get_lon_e7(void) { return gps_lon_e7; }
+uint32_t gps_get_epoch(void) { return gps_epoch; }
 
 uint8_t gps_get_hour(void) { return gps_h; }
 uint8_t gps_get_min(void) { return gps_m; }
@@ -10,6 +10,11 @@ uint8_t gps_fix_available(void);
 float gps_get_lat(void);
 float gps_get_lon(void);
 
+// fixed point degrees * 1e7 and UTC epoch (binary event protocol)
+int32_t gps_get_lat_e7(void);
+int32_t gps_get_lon_e7(void);
+uint32_t gps_get_epoch(void);
+
 
 uint8_t gps_get_hour(void);
 uint8_t gps_get_min(void);
@@ -0,0 +1,95 @@
+#ifndef IMAGE_FEC_H
+#define IMAGE_FEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "image_proto.h"
+
+/*
+   Systematic Cauchy Reed-Solomon over GF(2^8) for image chunks.
+
+   Parity row r (0 <= r < m) of a block holds
+       P_r = sum_j C[r][j] * D_j,   C[r][j] = 1 / (r ^ (m + j))
+   over the block's data chunks D_j, each zero-padded to
+   IMAGE_MAX_PAYLOAD. Every square submatrix of a Cauchy matrix is
+   invertible, so any m of the k + m chunks can be lost and rebuilt.
+
+   This file is the portable scalar part, shared by the ESP32 encoder
+   (plain C) and the server; the vectorised region kernels and the
+   decoder live in fec_simd.h.
+*/
+
+#define IMAGE_FEC_POLY      0x11D   /* x^8 + x^4 + x^3 + x^2 + 1 */
+#define IMAGE_FEC_MAX_K     64
+#define IMAGE_FEC_MAX_M     32
+
+typedef struct {
+    uint8_t exp[512];
+    uint8_t log[256];
+} image_gf_t;
+
+static inline void image_gf_init(image_gf_t *gf)
+{
+    unsigned x = 1;
+    for (int i = 0; i < 255; i++) {
+        gf->exp[i] = gf->exp[i + 255] = (uint8_t)x;
+        gf->log[x] = (uint8_t)i;
+        x <<= 1;
+        if (x & 0x100) x ^= IMAGE_FEC_POLY;
+    }
+    gf->exp[510] = gf->exp[511] = gf->exp[0];
+    gf->log[0] = 0;
+}
+
+static inline uint8_t image_gf_mul(const image_gf_t *gf, uint8_t a, uint8_t b)
+{
+    return (a && b) ? gf->exp[gf->log[a] + gf->log[b]] : 0;
+}
+
+static inline uint8_t image_gf_inv(const image_gf_t *gf, uint8_t a)
+{
+    return gf->exp[255 - gf->log[a]];
+}
+
+/* Cauchy coefficient of data chunk j in parity row r */
+static inline uint8_t image_fec_coef(const image_gf_t *gf, unsigned r, unsigned j, unsigned m)
+{
+    return image_gf_inv(gf, (uint8_t)(r ^ (m + j)));
+}
+
+/* m parity rows for the block of chunks [first, first + k) of a frame */
+static inline void image_fec_encode_block(const image_gf_t *gf,
+                                          const uint8_t *data, size_t len,
+                                          unsigned first, unsigned k, unsigned m,
+                                          uint8_t *parity /* m * IMAGE_MAX_PAYLOAD */)
+{
+    memset(parity, 0, (size_t)m * IMAGE_MAX_PAYLOAD);
+
+    for (unsigned j = 0; j < k; j++) {
+        size_t off = (size_t)(first + j) * IMAGE_MAX_PAYLOAD;
+        size_t n   = (len - off > IMAGE_MAX_PAYLOAD) ? IMAGE_MAX_PAYLOAD : (len - off);
+        const uint8_t *src = data + off;
+
+        for (unsigned r = 0; r < m; r++) {
+            uint8_t  c   = image_fec_coef(gf, r, j, m);
+            uint8_t *dst = parity + (size_t)r * IMAGE_MAX_PAYLOAD;
+            unsigned lc  = gf->log[c];
+
+            for (size_t i = 0; i < n; i++)
+                if (src[i]) dst[i] ^= gf->exp[lc + gf->log[src[i]]];
+        }
+    }
+}
+
+/* parity chunks per block for an overhead of pct percent, at least 1 */
+static inline unsigned image_fec_parity(unsigned k, unsigned pct)
+{
+    unsigned m = (k * pct + 99) / 100;
+    if (m < 1) m = 1;
+    if (m > IMAGE_FEC_MAX_M) m = IMAGE_FEC_MAX_M;
+    return m;
+}
+
+#endif
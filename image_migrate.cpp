@@ -0,0 +1,153 @@
+/*
+   Moves captures saved in the old layout (image_<id>/image_<id>.jpg, one
+   folder per image in receiver's working directory) into the pack
+   store (image_store.h).
+
+   Images are appended oldest first with their file mtime as capture
+   time and device 0 (unknown), so they land in the day partition they
+   were taken on. With --delete a folder is removed only once its image
+   has been fsynced into the store. The store allows one writer, so run
+   this while receiver is stopped.
+
+   g++ -std=c++17 -O2 image_migrate.cpp -o image_migrate
+   ./image_migrate [--from DIR] [--store DIR] [--delete]
+*/
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "image_store.h"
+
+#define MIGRATE_SYNC_EVERY  256     // images per fsync (and per --delete round)
+
+struct LegacyImage {
+    std::string folder;
+    std::string file;
+    uint16_t    frame_id;
+    uint32_t    mtime;
+};
+
+static std::vector<LegacyImage> find_legacy(const std::string& dir)
+{
+    std::vector<LegacyImage> found;
+
+    DIR* d = opendir(dir.c_str());
+    if (!d) return found;
+
+    while (dirent* e = readdir(d)) {
+        unsigned id;
+        char extra;
+        if (sscanf(e->d_name, "image_%u%c", &id, &extra) != 1 || id > 0xFFFF) continue;
+
+        LegacyImage im;
+        im.folder   = dir + "/" + e->d_name;
+        im.file     = im.folder + "/" + e->d_name + ".jpg";
+        im.frame_id = (uint16_t)id;
+
+        struct stat st;
+        if (stat(im.file.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        im.mtime = (uint32_t)st.st_mtime;
+        found.push_back(im);
+    }
+    closedir(d);
+
+    std::sort(found.begin(), found.end(),
+              [](const LegacyImage& a, const LegacyImage& b) { return a.mtime < b.mtime; });
+    return found;
+}
+
+/* fsync everything appended so far, then drop the folders it covers */
+static void checkpoint(ImageStore& store, std::vector<LegacyImage>& done, bool del)
+{
+    std::vector<int> fds;
+    store.dirty(fds);
+    for (int fd : fds) fsync(fd);
+    store.sync_done();
+
+    if (del)
+        for (const LegacyImage& im : done)
+            if (unlink(im.file.c_str()) != 0 || rmdir(im.folder.c_str()) != 0)
+                std::cerr << "[MIGRATE] could not remove " << im.folder << '\n';
+    done.clear();
+}
+
+static void usage(const char* prog)
+{
+    std::cerr << "usage: " << prog << " [--from DIR] [--store DIR] [--delete]\n";
+}
+
+int main(int argc, char* argv[])
+{
+    std::string from = ".", root = IMAGE_STORE_DIR;
+    bool del = false;
+
+    for (int i = 1; i < argc; i++) {
+        auto arg = [&](const char* name) { return !strcmp(argv[i], name) && i + 1 < argc; };
+
+        if (arg("--from"))                    from = argv[++i];
+        else if (arg("--store"))              root = argv[++i];
+        else if (!strcmp(argv[i], "--delete")) del = true;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    ImageStore store;
+    if (!store.open(root)) {
+        std::cerr << "[MIGRATE] cannot open image store " << root << '\n';
+        return 1;
+    }
+
+    std::vector<LegacyImage> images = find_legacy(from);
+    std::cout << "[MIGRATE] " << images.size() << " images in " << from << '\n';
+
+    std::vector<LegacyImage> done;
+    size_t moved = 0, failed = 0;
+    uint64_t bytes = 0;
+
+    for (const LegacyImage& im : images) {
+        std::ifstream f(im.file, std::ios::binary);
+        std::string jpeg((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+        ImageStore::Slot slot;
+        if (jpeg.empty() || !store.begin(im.mtime) || !store.reserve((uint32_t)jpeg.size(), slot) ||
+            pwrite(slot.fd, jpeg.data(), jpeg.size(), (off_t)slot.offset) != (ssize_t)jpeg.size()) {
+            std::cerr << "[MIGRATE] failed: " << im.file << '\n';
+            failed++;
+            continue;
+        }
+
+        ImageRecord r{};
+        r.crc32    = journal_crc32(jpeg.data(), jpeg.size());
+        r.time     = im.mtime;
+        r.frame_id = im.frame_id;
+        r.pack     = slot.pack;
+        r.len      = (uint32_t)jpeg.size();
+        r.offset   = slot.offset;
+        if (store.commit(&r, 1) < 0) {
+            std::cerr << "[MIGRATE] index write failed: " << im.file << '\n';
+            failed++;
+            continue;
+        }
+
+        moved++;
+        bytes += jpeg.size();
+        done.push_back(im);
+        if (done.size() == MIGRATE_SYNC_EVERY) checkpoint(store, done, del);
+    }
+    checkpoint(store, done, del);
+
+    std::cout << "[MIGRATE] moved " << moved << " images (" << bytes / 1024 << " KiB), "
+              << failed << " failed" << (del ? ", folders removed" : "") << '\n';
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,65 @@
+#ifndef IMAGE_PROTO_H
+#define IMAGE_PROTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+   ESP32-CAM ↔ server image transport (UDP, port 9200).
+
+   Camera → server: one datagram per chunk, jpeg_hdr_t + payload. Every
+   chunk but the last carries exactly IMAGE_MAX_PAYLOAD bytes, so chunk
+   k belongs at offset k * IMAGE_MAX_PAYLOAD. event_id is the journal ID
+   of the event whose "CAPTURE:<id>" command took the picture (0 for a
+   capture nobody asked for); every chunk of a frame carries it.
+
+   Server → camera: when a frame stalls with chunks missing, the
+   receiver answers the chunk's source address with an image_nack_t.
+   Bit i of the bitmap set means chunk (base_chunk + i) is missing; the
+   bitmap is only as long as the datagram. base_chunk is a multiple of 8.
+
+   Optional FEC (see image_fec.h): data chunks are grouped into blocks
+   of block_k; each block is followed by parity_m Reed-Solomon repair
+   chunks. Repair chunk r of block b has chunk_id
+   total_chunks + b * parity_m + r and a payload of image_fec_hdr_t +
+   IMAGE_MAX_PAYLOAD bytes. Any parity_m lost chunks of a block can be
+   rebuilt; receivers without FEC ignore chunk_id >= total_chunks.
+*/
+
+#define IMAGE_MAX_PAYLOAD   1400
+#define IMAGE_NACK_MAGIC    0x4B4E      /* bytes 4E 4B ("NK") on the wire */
+#define IMAGE_NACK_MAX_BITMAP 64        /* covers 512 chunks = 700 KB */
+
+typedef struct __attribute__((packed)) {
+    uint16_t frame_id;
+    uint16_t chunk_id;
+    uint16_t total_chunks;
+    uint16_t payload_size;
+    uint32_t event_id;
+} jpeg_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    uint16_t magic;
+    uint16_t frame_id;
+    uint16_t total_chunks;
+    uint16_t base_chunk;
+    uint8_t  bitmap[IMAGE_NACK_MAX_BITMAP];
+} image_nack_t;
+
+#define IMAGE_NACK_HDR_SIZE offsetof(image_nack_t, bitmap)
+
+typedef struct __attribute__((packed)) {
+    uint8_t  block_k;       /* data chunks per block (last block may be short) */
+    uint8_t  parity_m;      /* repair chunks per block */
+    uint16_t last_len;      /* payload of the frame's final data chunk */
+} image_fec_hdr_t;
+
+/* true if the NACK (len bytes as received) asks for chunk base_chunk + i */
+static inline int image_nack_wants(const image_nack_t *n, size_t len, size_t i)
+{
+    return i < (len - IMAGE_NACK_HDR_SIZE) * 8 &&
+           ((n->bitmap[i >> 3] >> (i & 7)) & 1) &&
+           n->base_chunk + i < n->total_chunks;
+}
+
+#endif
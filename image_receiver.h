@@ -0,0 +1,416 @@
+#pragma once
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include <fstream>
+#include <ctime>
+#include <iostream>
+#include <thread>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#include "live_state.h"
+#include "metrics.h"
+#include "frame_table.h"
+#include "image_proto.h"
+#include "fec_simd.h"
+#include "image_writer.h"
+#include "event_journal.h"
+#include "image_thumb.h"
+
+#define IMAGE_PORT      9200
+#define RX_BATCH        32                  // datagrams per recvmmsg()
+#define RX_DGRAM_MAX    1500
+#define RX_BUF_BYTES    (8 * 1024 * 1024)   // SO_RCVBUF per worker socket
+#define MAX_WORKERS     16
+
+#define FRAME_BUDGET_MB 64                  // reassembly memory, all workers
+#define THUMB_WORKERS   2
+
+/*
+   ESP32 image receiver: chunk reassembly, FEC repair, NACKs and the
+   hand-off to the image writer. Hosted by receiver and rvims_server.
+*/
+
+/*
+   One worker per SO_REUSEPORT socket. The kernel hashes each datagram's
+   source address/port to a socket, so every chunk of a frame (one
+   camera socket per image) lands on the same worker and the frame
+   tables need no locking. Frames are keyed by sender + frame_id so two
+   cameras sharing a worker never mix chunks.
+*/
+struct Worker {
+    int      id;
+    int      sock;
+    uint32_t kernel_drops = 0;      // last SO_RXQ_OVFL value seen
+    FrameTable   frames;
+    FecCodec     fec;
+    ImageWriter* writer = nullptr;
+};
+
+struct ImageReceiver {
+    LiveState*               live = nullptr;
+    bool                     json_files = false;
+    ImageWriter              writer;
+    ThumbPool                thumbs;
+    std::vector<Worker>      workers;
+    std::vector<std::thread> threads;
+};
+
+
+/* compatibility mode (--json-files): data/esp32.json for file readers */
+inline void write_esp32_json(const LiveImage& im)
+{
+    std::ofstream js("data/esp32.json.tmp");
+    if (!js.is_open()) return;
+
+    js << "[\n" << image_json(im) << "\n]\n";
+    js.close();
+    rename("data/esp32.json.tmp", "data/esp32.json");
+}
+
+/* ================= SOCKET ================= */
+inline int open_rx_socket(int port)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("[IMAGE] socket");
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+    setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one));
+
+    // wake up at least once per tick to expire stale frames
+    timeval tv = {0, FRAME_WHEEL_TICK_MS * 1000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    // FORCE ignores net.core.rmem_max but needs CAP_NET_ADMIN
+    int want = RX_BUF_BYTES;
+    if (setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &want, sizeof(want)) < 0)
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &want, sizeof(want));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(sock, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("[IMAGE] bind");
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/* ================= FRAME COMPLETE ================= */
+/*
+   Writer thread, once the JPEG is stored: the only image ring publisher.
+   The position comes from the event that asked for the picture.
+*/
+inline void publish_frame(ImageReceiver& rx, const ImageJob& job, const std::string& day, uint32_t n)
+{
+    std::string image_path = day + "/" + std::to_string(n) + ".jpg";
+    rx.thumbs.submit(day, n);
+
+    LiveImage im{};
+    im.id       = rx.live->images.head.load(std::memory_order_relaxed);
+    im.time     = (uint32_t)time(nullptr);
+    im.event_id = job.event_id;
+    im.frame_id = job.frame_id;
+    snprintf(im.path, sizeof(im.path), "%s", image_path.c_str());
+
+    EventRecord ev;
+    if (job.event_id && journal_lookup(JOURNAL_DIR, job.event_id, ev) && ev.has_fix) {
+        im.has_fix = 1;
+        im.lat     = ev.lat;
+        im.lon     = ev.lon;
+    }
+
+    rx.live->images.publish(im);
+    if (rx.json_files) write_esp32_json(im);
+
+    std::cout << "[IMAGE] Saved & published: "
+              << image_path << '\n';
+}
+
+/* ================= FEC ================= */
+/* rebuild the lost data chunks of one block once enough have arrived */
+inline void fec_repair(Worker& w, FrameBuffer& f, unsigned block)
+{
+    unsigned first = block * f.fec_k;
+    if (first >= f.total) return;
+    unsigned k = std::min<unsigned>(f.fec_k, f.total - first);
+    unsigned m = f.fec_m;
+
+    uint8_t* data[IMAGE_FEC_MAX_K];
+    uint8_t* par[IMAGE_FEC_MAX_M];
+    bool have_d[IMAGE_FEC_MAX_K], have_p[IMAGE_FEC_MAX_M];
+    unsigned nd = 0, np = 0;
+
+    for (unsigned j = 0; j < k; j++) {
+        data[j]   = f.data + (size_t)(first + j) * IMAGE_MAX_PAYLOAD;
+        have_d[j] = f.has(first + j);
+        nd += have_d[j];
+    }
+    for (unsigned r = 0; r < m; r++) {
+        unsigned id = f.total + block * m + r;
+        have_p[r] = id < FRAME_MAX_CHUNKS && f.has(id);
+        par[r]    = have_p[r] ? f.data + (size_t)id * IMAGE_MAX_PAYLOAD : nullptr;
+        np += have_p[r];
+    }
+    if (nd == k || nd + np < k) return;
+
+    int rebuilt = w.fec.decode(data, have_d, k, par, have_p, m, IMAGE_MAX_PAYLOAD);
+    if (rebuilt <= 0) return;
+
+    for (unsigned j = 0; j < k; j++)
+        if (!have_d[j]) f.test_and_set(first + j);
+
+    if (first + k == f.total && !have_d[k - 1])
+        f.len = (uint32_t)(f.total - 1) * IMAGE_MAX_PAYLOAD + f.fec_last_len;
+    f.received += rebuilt;
+    metric_inc(C_CHUNKS_FEC_RECOVERED, rebuilt);
+}
+
+/* ================= CHUNK ================= */
+inline void handle_chunk(Worker& w, const sockaddr_in& from, const uint8_t* buf, int len)
+{
+    if (len < (int)sizeof(jpeg_hdr_t)) return;
+
+    jpeg_hdr_t hdr;
+    memcpy(&hdr, buf, sizeof(hdr));
+    uint16_t frame_id = hdr.frame_id;
+
+    // safety: the header must describe exactly what arrived
+    if (hdr.payload_size != len - sizeof(jpeg_hdr_t))
+        return;
+
+    metric_inc(C_CHUNKS_RX);
+
+    // chunk_id past the data chunks: a Reed-Solomon repair chunk
+    bool parity = hdr.chunk_id >= hdr.total_chunks;
+    image_fec_hdr_t fh{};
+    if (parity && hdr.payload_size == sizeof(fh) + IMAGE_MAX_PAYLOAD)
+        memcpy(&fh, buf + sizeof(jpeg_hdr_t), sizeof(fh));
+
+    if (hdr.total_chunks == 0 || hdr.total_chunks > FRAME_MAX_CHUNKS ||
+        hdr.chunk_id >= FRAME_MAX_CHUNKS ||
+        (!parity && (hdr.payload_size == 0 || hdr.payload_size > IMAGE_MAX_PAYLOAD ||
+                     (hdr.chunk_id + 1 < hdr.total_chunks && hdr.payload_size != IMAGE_MAX_PAYLOAD))) ||
+        (parity && (fh.block_k == 0 || fh.block_k > IMAGE_FEC_MAX_K ||
+                    fh.parity_m == 0 || fh.parity_m > IMAGE_FEC_MAX_M ||
+                    fh.last_len == 0 || fh.last_len > IMAGE_MAX_PAYLOAD))) {
+        metric_inc(C_CHUNKS_BAD);
+        return;
+    }
+
+    uint64_t key = (uint64_t)ntohl(from.sin_addr.s_addr) << 32 |
+                   (uint64_t)ntohs(from.sin_port) << 16 | frame_id;
+    FrameBuffer* f = w.frames.find(key);
+
+    // chunk of a frame already written out (late parity is expected)
+    if (f && f->done) {
+        if (!parity) metric_inc(C_CHUNKS_DUP);
+        return;
+    }
+
+    // frame_id reused by a new image: the old one can never complete
+    if (f && f->total != hdr.total_chunks) {
+        w.frames.drop(f);
+        f = nullptr;
+    }
+
+    if (!f) {
+        f = w.frames.insert(key, hdr.total_chunks);
+        if (!f) return;
+        f->event_id = hdr.event_id;
+    }
+
+    // duplicate UDP packet protection
+    if (f->test_and_set(hdr.chunk_id)) {
+        metric_inc(C_CHUNKS_DUP);
+        return;
+    }
+
+    uint8_t* slot = f->data + (size_t)hdr.chunk_id * IMAGE_MAX_PAYLOAD;
+    unsigned block;
+
+    if (parity) {
+        memcpy(slot, buf + sizeof(jpeg_hdr_t) + sizeof(fh), IMAGE_MAX_PAYLOAD);
+        f->fec_k        = fh.block_k;
+        f->fec_m        = fh.parity_m;
+        f->fec_last_len = fh.last_len;
+        block = (hdr.chunk_id - f->total) / f->fec_m;
+        metric_inc(C_CHUNKS_PARITY);
+    } else {
+        memcpy(slot, buf + sizeof(jpeg_hdr_t), hdr.payload_size);
+        if (hdr.chunk_id + 1 == f->total) {
+            // parity covers the last chunk zero-padded (payload_size checked above)
+            memset(slot + hdr.payload_size, 0, IMAGE_MAX_PAYLOAD - hdr.payload_size);
+            f->len = (uint32_t)hdr.chunk_id * IMAGE_MAX_PAYLOAD + hdr.payload_size;
+        }
+        f->received++;
+        block = f->fec_k ? hdr.chunk_id / f->fec_k : 0;
+    }
+
+    if (f->fec_m && f->received < f->total) fec_repair(w, *f, block);
+    w.frames.activity(f);
+
+    if (f->received == f->total) {
+        metric_observe_ns(H_FRAME_REASSEMBLY, metrics_now_ns() - f->first_ns);
+        metric_inc(C_FRAMES_DONE);
+
+        uint32_t len = f->len;
+        uint32_t event_id = f->event_id;
+        w.writer->submit(ImageJob{w.frames.complete(f), len, (uint32_t)(key >> 32), event_id,
+                               frame_id, (uint16_t)w.id, metrics_now_ns()});
+    }
+}
+
+/* ================= NACK ================= */
+/* ask the camera (at the chunks' source address) for what is missing */
+inline void send_nack(Worker& w, const FrameBuffer& f)
+{
+    image_nack_t nack{};
+    nack.magic        = IMAGE_NACK_MAGIC;
+    nack.frame_id     = (uint16_t)f.key;
+    nack.total_chunks = f.total;
+
+    int first = -1, last = -1;
+    for (int k = 0; k < f.total; k++) {
+        if (f.has(k)) continue;
+        if (first < 0) first = k & ~7;
+        last = k;
+        nack.bitmap[(k - first) >> 3] |= 1 << ((k - first) & 7);
+    }
+    if (first < 0) return;
+    nack.base_chunk = (uint16_t)first;
+
+    sockaddr_in to{};
+    to.sin_family      = AF_INET;
+    to.sin_addr.s_addr = htonl((uint32_t)(f.key >> 32));
+    to.sin_port        = htons((uint16_t)(f.key >> 16));
+
+    size_t len = IMAGE_NACK_HDR_SIZE + (last - first) / 8 + 1;
+    sendto(w.sock, &nack, len, 0, (sockaddr*)&to, sizeof(to));
+    metric_inc(C_NACKS_SENT);
+}
+
+/* ================= RX LOOP ================= */
+inline void rx_loop(Worker& w)
+{
+    static thread_local uint8_t bufs[RX_BATCH][RX_DGRAM_MAX];
+    static thread_local char    ctrl[RX_BATCH][CMSG_SPACE(sizeof(uint32_t))];
+
+    sockaddr_in    from[RX_BATCH];
+    iovec          iov[RX_BATCH];
+    mmsghdr        msgs[RX_BATCH];
+
+    while (1) {
+        for (int i = 0; i < RX_BATCH; i++) {
+            iov[i] = {bufs[i], RX_DGRAM_MAX};
+            msgs[i] = {};
+            msgs[i].msg_hdr.msg_name       = &from[i];
+            msgs[i].msg_hdr.msg_namelen    = sizeof(from[i]);
+            msgs[i].msg_hdr.msg_iov        = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen     = 1;
+            msgs[i].msg_hdr.msg_control    = ctrl[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(ctrl[i]);
+        }
+
+        // block for the first datagram (or one wheel tick), then take
+        // whatever else is queued
+        int n = recvmmsg(w.sock, msgs, RX_BATCH, MSG_WAITFORONE, nullptr);
+        w.writer->reclaim(w.id, [&w](uint8_t* slab) { w.frames.put_slab(slab); });
+        w.frames.advance(frame_now_ms(),
+                         [&w](const FrameBuffer& f) { send_nack(w, f); });
+        if (n <= 0) continue;
+
+        for (int i = 0; i < n; i++) {
+            msghdr& mh = msgs[i].msg_hdr;
+
+            // SO_RXQ_OVFL: cumulative drops on this socket so far
+            for (cmsghdr* cm = CMSG_FIRSTHDR(&mh); cm; cm = CMSG_NXTHDR(&mh, cm)) {
+                if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SO_RXQ_OVFL) continue;
+                uint32_t drops;
+                memcpy(&drops, CMSG_DATA(cm), sizeof(drops));
+                if (drops != w.kernel_drops) {
+                    metric_inc(C_UDP_KERNEL_DROPS, drops - w.kernel_drops);
+                    w.kernel_drops = drops;
+                }
+            }
+
+            handle_chunk(w, from[i], bufs[i], (int)msgs[i].msg_len);
+        }
+    }
+}
+
+/* ================= SETUP ================= */
+struct ReceiverOptions {
+    int                port          = IMAGE_PORT;
+    int                workers       = std::min<int>(std::max(1u, std::thread::hardware_concurrency()), 4);
+    int                budget_mb     = FRAME_BUDGET_MB;
+    int                thumb_workers = THUMB_WORKERS;
+    bool               json_files    = false;
+    ImageWriterOptions writer;
+};
+
+/* sockets, frame tables, writer and thumbnail pool; false on failure */
+inline bool receiver_open(ImageReceiver& rx, const ReceiverOptions& o, LiveState* live)
+{
+    rx.live       = live;
+    rx.json_files = o.json_files;
+
+    // ensure data folder exists
+    mkdir("data", 0777);
+
+    // every worker gets an equal share of the reassembly budget
+    int nworkers = o.workers;
+    size_t slabs = std::max<size_t>(2, (size_t)o.budget_mb * 1024 * 1024 / FRAME_SLAB_BYTES / nworkers);
+
+    rx.workers.resize(nworkers);
+    for (int i = 0; i < nworkers; i++) {
+        Worker& w = rx.workers[i];
+        w.id     = i;
+        w.sock   = open_rx_socket(o.port);
+        w.writer = &rx.writer;
+        if (w.sock < 0) return false;
+        w.frames.init(slabs);
+    }
+    rx.thumbs.start(o.thumb_workers, o.writer.dir);
+    auto publish = [&rx](const ImageJob& job, const std::string& day, uint32_t n) {
+        publish_frame(rx, job, day, n);
+    };
+    if (!rx.writer.start(nworkers, slabs, o.writer, publish)) {
+        std::cerr << "[IMAGE] cannot open image store " << o.writer.dir << '\n';
+        return false;
+    }
+
+    int rcvbuf = 0;
+    socklen_t sl = sizeof(rcvbuf);
+    getsockopt(rx.workers[0].sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &sl);
+    rcvbuf /= 2;    // the kernel reports twice the usable size
+
+    std::cout << "[IMAGE] Receiver ready on port " << o.port << " ("
+              << nworkers << " workers, rcvbuf " << rcvbuf / 1024 << " KiB, "
+              << slabs << " frames/worker, " << rx.writer.backend() << " writer, "
+              << o.thumb_workers << " thumbnail workers)\n";
+    if (rcvbuf < RX_BUF_BYTES)
+        std::cout << "[IMAGE] rcvbuf capped by net.core.rmem_max; raise it to "
+                  << RX_BUF_BYTES << " to absorb camera bursts\n";
+    return true;
+}
+
+/* one thread per worker socket; join rx.threads to wait on them */
+inline void receiver_start(ImageReceiver& rx)
+{
+    for (auto &w : rx.workers)
+        rx.threads.emplace_back(rx_loop, std::ref(w));
+}
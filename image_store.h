@@ -0,0 +1,416 @@
+#pragma once
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "event_journal.h"      // journal_crc32
+
+/*
+   Append-only image store.
+
+   data/images/<YYYY-MM-DD>/pack-<n>.dat   JPEGs back to back
+   data/images/<YYYY-MM-DD>/index.dat      one 32-byte ImageRecord each
+
+   The UTC day of the capture is the partition: a time window only opens
+   the days it spans, and old days are archived or deleted as whole
+   directories. An image is addressed as "<day>/<n>.jpg", n being its
+   slot in the day's index.
+
+   A JPEG is written before its index record and the record's CRC covers
+   the JPEG, so after a crash the trailing records are checked against
+   their packs and everything from the first bad one is cut off. Only
+   one process writes at a time (flock on data/images/.lock); readers
+   need no locking.
+*/
+
+#define IMAGE_STORE_DIR     "data/images"
+#define IMAGE_PACK_BYTES    (256u << 20)        // start a new pack beyond this
+#define IMAGE_STORE_MAGIC   0x31495652u         // "RVI1"
+#define IMAGE_RECOVER_CHECK 64                  // trailing records verified on open
+#define IMAGE_MAP_MAX       64                  // packs kept mapped by ImagePackCache
+
+struct ImageRecord {
+    uint32_t magic;
+    uint32_t crc32;     // over the JPEG
+    uint32_t time;      // capture, UTC epoch seconds
+    uint32_t device;    // camera IPv4 address, host order (0 = unknown)
+    uint32_t event_id;  // triggering event (journal ID), 0 = none
+    uint16_t frame_id;
+    uint16_t pack;
+    uint32_t len;
+    uint32_t offset;    // within the pack
+};
+
+static_assert(sizeof(ImageRecord) == 32, "image index record must stay 32 bytes");
+static_assert(IMAGE_PACK_BYTES <= 0xFFFFFFFFull - (512u << 10),
+              "pack offsets must fit the record's 32 bits");
+
+inline std::string image_store_day(uint32_t t)
+{
+    time_t tt = t;
+    tm g;
+    gmtime_r(&tt, &g);
+    char buf[16];
+    strftime(buf, sizeof(buf), "%Y-%m-%d", &g);
+    return buf;
+}
+
+/* "YYYY-MM-DD" and nothing else (also keeps request paths inside the store) */
+inline bool image_store_day_valid(const std::string& day)
+{
+    if (day.size() != 10 || day[4] != '-' || day[7] != '-') return false;
+    for (size_t i = 0; i < day.size(); i++)
+        if (i != 4 && i != 7 && (day[i] < '0' || day[i] > '9')) return false;
+    return true;
+}
+
+inline std::string image_pack_path(const std::string& root, const std::string& day, uint16_t pack)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/pack-%04u.dat", (unsigned)pack);
+    return root + "/" + day + name;
+}
+
+inline std::string image_index_path(const std::string& root, const std::string& day)
+{
+    return root + "/" + day + "/index.dat";
+}
+
+/* every day partition, oldest first */
+inline std::vector<std::string> image_store_days(const std::string& root)
+{
+    std::vector<std::string> days;
+
+    DIR* d = opendir(root.c_str());
+    if (!d) return days;
+
+    while (dirent* e = readdir(d))
+        if (image_store_day_valid(e->d_name)) days.push_back(e->d_name);
+    closedir(d);
+
+    std::sort(days.begin(), days.end());
+    return days;
+}
+
+/* ================= READER ================= */
+/* the valid records of one day's index, from slot `from` on */
+inline std::vector<ImageRecord> image_store_index(const std::string& root, const std::string& day,
+                                                  uint32_t from = 0)
+{
+    std::vector<ImageRecord> recs;
+
+    int fd = ::open(image_index_path(root, day).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return recs;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size > (size_t)from * sizeof(ImageRecord)) {
+        recs.resize((size_t)st.st_size / sizeof(ImageRecord) - from);
+        ssize_t n = pread(fd, recs.data(), recs.size() * sizeof(ImageRecord),
+                          (off_t)from * sizeof(ImageRecord));
+        recs.resize(n > 0 ? (size_t)n / sizeof(ImageRecord) : 0);
+    }
+    ::close(fd);
+
+    size_t valid = 0;
+    while (valid < recs.size() && recs[valid].magic == IMAGE_STORE_MAGIC) valid++;
+    recs.resize(valid);
+    return recs;
+}
+
+inline bool image_store_record(const std::string& root, const std::string& day,
+                               uint32_t n, ImageRecord& r)
+{
+    int fd = ::open(image_index_path(root, day).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    bool ok = pread(fd, &r, sizeof(r), (off_t)n * sizeof(r)) == (ssize_t)sizeof(r) &&
+              r.magic == IMAGE_STORE_MAGIC;
+    ::close(fd);
+    return ok;
+}
+
+/* JPEG bytes of a record */
+inline bool image_store_read(const std::string& root, const std::string& day,
+                             const ImageRecord& r, std::string& out)
+{
+    int fd = ::open(image_pack_path(root, day, r.pack).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    out.resize(r.len);
+    bool ok = pread(fd, &out[0], r.len, (off_t)r.offset) == (ssize_t)r.len;
+    ::close(fd);
+    return ok;
+}
+
+/* every image captured in [from, to], oldest first: fn(day, n, record) */
+inline void image_store_scan(const std::string& root, uint32_t from, uint32_t to,
+                             const std::function<void(const std::string&, uint32_t, const ImageRecord&)>& fn)
+{
+    std::string first = image_store_day(from), last = image_store_day(to);
+
+    for (const std::string& day : image_store_days(root)) {
+        if (day < first || day > last) continue;
+
+        std::vector<ImageRecord> recs = image_store_index(root, day);
+        for (uint32_t n = 0; n < recs.size(); n++)
+            if (recs[n].time >= from && recs[n].time <= to) fn(day, n, recs[n]);
+    }
+}
+
+/* ================= MAPPED READER ================= */
+/* a whole file, mapped read-only; unmapped when the last user lets go */
+struct ImageMapping {
+    const uint8_t* base = nullptr;
+    size_t         size = 0;
+
+    ~ImageMapping() { if (base) munmap((void*)base, size); }
+};
+
+inline std::shared_ptr<const ImageMapping> image_map_file(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    void* p = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) return nullptr;
+
+    auto m = std::make_shared<ImageMapping>();
+    m->base = (const uint8_t*)p;
+    m->size = (size_t)st.st_size;
+    return m;
+}
+
+/*
+   Packs mapped once and shared by every request: an image is served as
+   a slice of the page cache, so many viewers of the same images cost no
+   extra memory and nothing is copied in user space. Packs only grow; a
+   mapping too short for a record is replaced by a fresh one, and
+   requests still holding the old one keep it until they finish.
+*/
+class ImagePackCache {
+public:
+    explicit ImagePackCache(std::string root = IMAGE_STORE_DIR) : root_(std::move(root)) {}
+
+    /* mapping that holds record r of that day, null if the pack can't be read */
+    std::shared_ptr<const ImageMapping> map(const std::string& day, const ImageRecord& r)
+    {
+        std::string path = image_pack_path(root_, day, r.pack);
+        size_t need = (size_t)r.offset + r.len;
+
+        std::lock_guard<std::mutex> lk(mu_);
+        Entry& e = maps_[path];
+        e.used = ++tick_;
+        if (e.map && e.map->size >= need) return e.map;
+
+        e.map = image_map_file(path);
+        if (!e.map || e.map->size < need) {
+            maps_.erase(path);
+            return nullptr;
+        }
+        std::shared_ptr<const ImageMapping> m = e.map;
+
+        // least recently used packs go first
+        while (maps_.size() > IMAGE_MAP_MAX) {
+            auto old = maps_.begin();
+            for (auto it = maps_.begin(); it != maps_.end(); ++it)
+                if (it->second.used < old->second.used) old = it;
+            maps_.erase(old);
+        }
+        return m;
+    }
+
+private:
+    struct Entry {
+        std::shared_ptr<const ImageMapping> map;
+        uint64_t                            used = 0;
+    };
+
+    std::string                            root_;
+    std::mutex                             mu_;
+    std::unordered_map<std::string, Entry> maps_;
+    uint64_t                               tick_ = 0;
+};
+
+/* ================= WRITER ================= */
+/*
+   Single writer, batch at a time:
+       begin(t)     pick the day partition for the batch
+       reserve(len) where the next JPEG goes; the caller writes it
+       commit(recs) append the written images' records to the index
+   Files replaced by a new day or pack stay open until sync_done(), so
+   the caller can still fsync them together with the rest (dirty()).
+*/
+class ImageStore {
+public:
+    struct Slot {
+        int      fd;
+        uint16_t pack;
+        uint32_t offset;
+    };
+
+    ~ImageStore()
+    {
+        close_day();
+        sync_done();
+        if (lock_fd_ >= 0) ::close(lock_fd_);
+        if (root_fd_ >= 0) ::close(root_fd_);
+    }
+
+    bool open(const std::string& root = IMAGE_STORE_DIR)
+    {
+        root_ = root;
+        mkdir("data", 0777);
+        mkdir(root_.c_str(), 0777);
+
+        root_fd_ = ::open(root_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        lock_fd_ = ::open((root_ + "/.lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (root_fd_ < 0 || lock_fd_ < 0) return false;
+
+        if (flock(lock_fd_, LOCK_EX | LOCK_NB) != 0) {
+            fprintf(stderr, "[STORE] %s is in use by another writer\n", root_.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool begin(uint32_t t)
+    {
+        std::string day = image_store_day(t);
+        if (day == day_ && index_fd_ >= 0) return true;
+
+        close_day();
+        return open_day(day);
+    }
+
+    bool reserve(uint32_t len, Slot& s)
+    {
+        if (pack_size_ && pack_size_ + len > IMAGE_PACK_BYTES && !open_pack(pack_ + 1, 0))
+            return false;
+
+        s = Slot{pack_fd_, pack_, pack_size_};
+        pack_size_ += len;
+        return true;
+    }
+
+    /* n records of the current day; returns the slot of the first, -1 on error */
+    int64_t commit(ImageRecord* recs, size_t n)
+    {
+        for (size_t i = 0; i < n; i++) recs[i].magic = IMAGE_STORE_MAGIC;
+
+        size_t bytes = n * sizeof(ImageRecord);
+        if (pwrite(index_fd_, recs, bytes, (off_t)fill_ * sizeof(ImageRecord)) != (ssize_t)bytes)
+            return -1;
+
+        fill_ += (uint32_t)n;
+        return fill_ - n;
+    }
+
+    /* everything an fsync must cover for the images committed so far */
+    void dirty(std::vector<int>& fds) const
+    {
+        fds.insert(fds.end(), retired_.begin(), retired_.end());
+        for (int fd : {pack_fd_, index_fd_, day_fd_, root_fd_})
+            if (fd >= 0) fds.push_back(fd);
+    }
+
+    /* after the fsync (or when writeback is left to the kernel) */
+    void sync_done()
+    {
+        for (int fd : retired_) ::close(fd);
+        retired_.clear();
+    }
+
+    const std::string& day()            const { return day_; }
+    uint32_t           recovered_torn() const { return recovered_torn_; }
+
+private:
+    bool open_day(const std::string& day)
+    {
+        day_ = day;
+        std::string dir = root_ + "/" + day;
+        mkdir(dir.c_str(), 0777);
+
+        day_fd_   = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        index_fd_ = ::open(image_index_path(root_, day).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (day_fd_ < 0 || index_fd_ < 0) return false;
+
+        /* crash recovery: valid prefix of the index whose JPEGs made it to disk */
+        std::vector<ImageRecord> recs = image_store_index(root_, day);
+        size_t n = recs.size();
+        size_t check = n > IMAGE_RECOVER_CHECK ? n - IMAGE_RECOVER_CHECK : 0;
+        std::string jpeg;
+        for (size_t i = check; i < n; i++)
+            if (!image_store_read(root_, day, recs[i], jpeg) ||
+                journal_crc32(jpeg.data(), jpeg.size()) != recs[i].crc32) {
+                n = i;
+                break;
+            }
+
+        struct stat st;
+        if (fstat(index_fd_, &st) == 0 && (size_t)st.st_size > n * sizeof(ImageRecord)) {
+            recovered_torn_ += (uint32_t)(st.st_size / sizeof(ImageRecord) - n);
+            if (ftruncate(index_fd_, (off_t)(n * sizeof(ImageRecord))) != 0) return false;
+        }
+        fill_ = (uint32_t)n;
+
+        // carry on in the last pack, past its last good image
+        if (n == 0) return open_pack(0, 0);
+        return open_pack(recs[n - 1].pack, recs[n - 1].offset + recs[n - 1].len);
+    }
+
+    bool open_pack(uint16_t pack, uint32_t size)
+    {
+        if (pack_fd_ >= 0) retired_.push_back(pack_fd_);
+
+        pack_fd_ = ::open(image_pack_path(root_, day_, pack).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (pack_fd_ < 0) return false;
+
+        // whatever follows the last indexed image is a torn write
+        if (ftruncate(pack_fd_, (off_t)size) != 0) return false;
+
+        pack_ = pack;
+        pack_size_ = size;
+        return true;
+    }
+
+    void close_day()
+    {
+        for (int* fd : {&pack_fd_, &index_fd_, &day_fd_}) {
+            if (*fd >= 0) retired_.push_back(*fd);
+            *fd = -1;
+        }
+        day_.clear();
+    }
+
+    std::string      root_;
+    std::string      day_;
+    int              root_fd_  = -1;
+    int              lock_fd_  = -1;
+    int              day_fd_   = -1;
+    int              index_fd_ = -1;
+    int              pack_fd_  = -1;
+    uint16_t         pack_      = 0;
+    uint32_t         pack_size_ = 0;
+    uint32_t         fill_      = 0;
+    uint32_t         recovered_torn_ = 0;
+    std::vector<int> retired_;      // replaced files awaiting their fsync
+};
@@ -0,0 +1,346 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <csetjmp>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <jpeglib.h>            // link with -ljpeg (libjpeg-turbo)
+
+#include "metrics.h"
+#include "image_store.h"
+
+/*
+   Gallery thumbnails, made as soon as an image is stored.
+
+   libjpeg scales while it decodes (scale_denom): at 1/8 only the DC
+   coefficient of each 8x8 block is used, at 1/4 and 1/2 a reduced IDCT
+   runs, so a thumbnail costs a fraction of a full decode and needs no
+   resampling pass. Every image gets a 1/2, 1/4 and 1/8 version.
+
+   data/images/<day>/thumbs.dat   the three JPEGs of an image back to back
+   data/images/<day>/thumbs.idx   ThumbRecord in slot n for image n
+
+   A pool of workers fills the slots in any order, so a slot stays zero
+   until its image has been done. Thumbnails are never fsynced: they can
+   always be made again, a torn one fails its CRC, and readers then
+   scale the full image on the fly (as for images stored before this).
+*/
+
+#define THUMB_SCALES        3               // 1/2, 1/4, 1/8
+#define THUMB_QUALITY       75
+#define THUMB_MIN_WIDTH     200             // gallery tile, .thumb in style.css
+#define THUMB_QUEUE_MAX     256             // images waiting; beyond that they are skipped
+#define THUMB_MAGIC         0x31485452u     // "RTH1"
+
+struct ThumbRecord {
+    uint32_t magic;
+    uint32_t crc32;                 // over all three JPEGs
+    uint32_t offset;                // in thumbs.dat
+    uint32_t len[THUMB_SCALES];
+    uint16_t width[THUMB_SCALES];
+    uint16_t reserved;
+};
+
+static_assert(sizeof(ThumbRecord) == 32, "thumbnail record must stay 32 bytes");
+
+inline unsigned thumb_denom(unsigned scale) { return 2u << scale; }
+
+/* smallest scale that still fills a gallery tile */
+inline unsigned thumb_fit(unsigned width)
+{
+    unsigned denom = 8;
+    while (denom > 2 && (width + denom - 1) / denom < THUMB_MIN_WIDTH) denom /= 2;
+    return denom;
+}
+
+inline std::string thumb_data_path(const std::string& root, const std::string& day)
+{
+    return root + "/" + day + "/thumbs.dat";
+}
+
+inline std::string thumb_index_path(const std::string& root, const std::string& day)
+{
+    return root + "/" + day + "/thumbs.idx";
+}
+
+/* ================= SCALING ================= */
+struct JpegError {
+    jpeg_error_mgr mgr;
+    jmp_buf        jump;
+};
+
+inline void jpeg_error_exit(j_common_ptr c) { longjmp(((JpegError*)c->err)->jump, 1); }
+inline void jpeg_error_quiet(j_common_ptr) {}
+
+/*
+   jpeg_scale() body. The output buffer belongs to the caller: libjpeg
+   changes it after setjmp, so it must not be a local of this frame when
+   longjmp lands here.
+*/
+inline bool jpeg_scale_to(const uint8_t* data, size_t len, unsigned denom,
+                          unsigned char** buf, unsigned long* size, uint16_t* width)
+{
+    jpeg_decompress_struct d;
+    jpeg_compress_struct   c;
+    JpegError              err;
+
+    d.err = c.err = jpeg_std_error(&err.mgr);
+    err.mgr.error_exit     = jpeg_error_exit;
+    err.mgr.output_message = jpeg_error_quiet;
+    jpeg_create_decompress(&d);
+    jpeg_create_compress(&c);
+
+    if (setjmp(err.jump)) {
+        jpeg_destroy_compress(&c);
+        jpeg_destroy_decompress(&d);
+        return false;
+    }
+
+    jpeg_mem_src(&d, (unsigned char*)data, (unsigned long)len);
+    jpeg_read_header(&d, TRUE);
+
+    d.scale_num           = 1;
+    d.scale_denom         = denom ? denom : thumb_fit(d.image_width);
+    d.dct_method          = JDCT_IFAST;
+    d.do_fancy_upsampling = FALSE;
+    jpeg_start_decompress(&d);
+
+    jpeg_mem_dest(&c, buf, size);
+    c.image_width      = d.output_width;
+    c.image_height     = d.output_height;
+    c.input_components = d.output_components;
+    c.in_color_space   = d.out_color_space;
+    jpeg_set_defaults(&c);
+    jpeg_set_quality(&c, THUMB_QUALITY, TRUE);
+    jpeg_start_compress(&c, TRUE);
+
+    JSAMPARRAY row = (*d.mem->alloc_sarray)((j_common_ptr)&d, JPOOL_IMAGE,
+                                            d.output_width * d.output_components, 1);
+    while (d.output_scanline < d.output_height) {
+        jpeg_read_scanlines(&d, row, 1);
+        jpeg_write_scanlines(&c, row, 1);
+    }
+    jpeg_finish_compress(&c);
+    jpeg_finish_decompress(&d);
+
+    if (width) *width = (uint16_t)d.output_width;
+
+    jpeg_destroy_compress(&c);
+    jpeg_destroy_decompress(&d);
+    return true;
+}
+
+/*
+   Decode at 1/denom and re-encode. denom 0 picks the smallest scale
+   that is still THUMB_MIN_WIDTH wide. False if libjpeg can't read it.
+*/
+inline bool jpeg_scale(const uint8_t* data, size_t len, unsigned denom,
+                       std::string& out, uint16_t* width = nullptr)
+{
+    unsigned char* buf  = nullptr;
+    unsigned long  size = 0;
+
+    bool ok = jpeg_scale_to(data, len, denom, &buf, &size, width);
+    if (ok) out.assign((const char*)buf, size);
+    free(buf);
+    return ok;
+}
+
+/* all three scales of one image, for ThumbStore::put() */
+inline bool thumb_make(const std::string& jpeg, std::string& out, ThumbRecord& r)
+{
+    r = ThumbRecord{};
+    out.clear();
+
+    std::string one;
+    for (unsigned s = 0; s < THUMB_SCALES; s++) {
+        if (!jpeg_scale((const uint8_t*)jpeg.data(), jpeg.size(), thumb_denom(s), one, &r.width[s]))
+            return false;
+        r.len[s] = (uint32_t)one.size();
+        out += one;
+    }
+    r.crc32 = journal_crc32(out.data(), out.size());
+    return true;
+}
+
+/* ================= READER ================= */
+/*
+   Stored thumbnail of image n: denom 2, 4 or 8, or 0 for the smallest
+   one at least THUMB_MIN_WIDTH wide. False if it hasn't been made (yet).
+*/
+inline bool thumb_read(const std::string& root, const std::string& day, uint32_t n,
+                       unsigned denom, std::string& out)
+{
+    ThumbRecord r;
+    int fd = ::open(thumb_index_path(root, day).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = pread(fd, &r, sizeof(r), (off_t)n * sizeof(r)) == (ssize_t)sizeof(r) &&
+              r.magic == THUMB_MAGIC;
+    ::close(fd);
+    if (!ok) return false;
+
+    unsigned pick = THUMB_SCALES - 1;
+    if (denom)
+        while (pick > 0 && thumb_denom(pick) > denom) pick--;
+    else
+        while (pick > 0 && r.width[pick] < THUMB_MIN_WIDTH) pick--;
+
+    uint32_t total = 0, skip = 0;
+    for (unsigned s = 0; s < THUMB_SCALES; s++) {
+        if (s < pick) skip += r.len[s];
+        total += r.len[s];
+    }
+
+    fd = ::open(thumb_data_path(root, day).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    std::string all(total, '\0');
+    ok = pread(fd, &all[0], total, (off_t)r.offset) == (ssize_t)total &&
+         journal_crc32(all.data(), all.size()) == r.crc32;
+    ::close(fd);
+    if (!ok) return false;
+
+    out = all.substr(skip, r.len[pick]);
+    return true;
+}
+
+/* ================= WRITER ================= */
+/* shared by the pool's workers; only the receiver (store lock holder) writes */
+class ThumbStore {
+public:
+    explicit ThumbStore(std::string root = IMAGE_STORE_DIR) : root_(std::move(root)) {}
+    ~ThumbStore() { close_day(); }
+
+    bool put(const std::string& day, uint32_t n, const std::string& data, ThumbRecord r)
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (day != day_ && !open_day(day)) return false;
+        if (size_ + data.size() > 0xFFFFFFFFull) return false;
+
+        r.magic  = THUMB_MAGIC;
+        r.offset = (uint32_t)size_;
+        if (pwrite(data_fd_, data.data(), data.size(), (off_t)size_) != (ssize_t)data.size())
+            return false;
+        size_ += data.size();
+
+        return pwrite(index_fd_, &r, sizeof(r), (off_t)n * sizeof(r)) == (ssize_t)sizeof(r);
+    }
+
+private:
+    bool open_day(const std::string& day)
+    {
+        close_day();
+        data_fd_  = ::open(thumb_data_path(root_, day).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        index_fd_ = ::open(thumb_index_path(root_, day).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        struct stat st;
+        if (data_fd_ < 0 || index_fd_ < 0 || fstat(data_fd_, &st) != 0) {
+            close_day();
+            return false;
+        }
+        // append past anything a crash left behind; records point at what they own
+        size_ = (uint64_t)st.st_size;
+        day_  = day;
+        return true;
+    }
+
+    void close_day()
+    {
+        for (int* fd : {&data_fd_, &index_fd_}) {
+            if (*fd >= 0) ::close(*fd);
+            *fd = -1;
+        }
+        day_.clear();
+    }
+
+    std::string root_;
+    std::string day_;
+    std::mutex  mu_;
+    int         data_fd_  = -1;
+    int         index_fd_ = -1;
+    uint64_t    size_     = 0;
+};
+
+/* ================= WORKER POOL ================= */
+/*
+   submit() is called by the image writer after each stored image and
+   never blocks it: when the workers fall THUMB_QUEUE_MAX behind, new
+   images are skipped and get scaled on request instead.
+*/
+class ThumbPool {
+public:
+    void start(size_t threads, const std::string& root = IMAGE_STORE_DIR)
+    {
+        root_  = root;
+        store_.reset(new ThumbStore(root));
+        for (size_t i = 0; i < threads; i++)
+            std::thread(&ThumbPool::run, this).detach();
+        threads_ = threads;
+    }
+
+    void submit(const std::string& day, uint32_t n)
+    {
+        if (!threads_) return;
+        {
+            std::lock_guard<std::mutex> lk(mu_);
+            if (queue_.size() >= THUMB_QUEUE_MAX) {
+                metric_inc(C_THUMBS_SKIPPED);
+                return;
+            }
+            queue_.push_back(Job{day, n});
+        }
+        metric_gauge_add(G_THUMB_QUEUE, 1);
+        cv_.notify_one();
+    }
+
+private:
+    struct Job {
+        std::string day;
+        uint32_t    n;
+    };
+
+    void run()
+    {
+        std::string jpeg, thumbs;
+        for (;;) {
+            Job j;
+            {
+                std::unique_lock<std::mutex> lk(mu_);
+                cv_.wait(lk, [this] { return !queue_.empty(); });
+                j = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            metric_gauge_add(G_THUMB_QUEUE, -1);
+
+            // just written, so this is a page cache read
+            uint64_t t0 = metrics_now_ns();
+            ImageRecord ir;
+            ThumbRecord tr;
+            if (!image_store_record(root_, j.day, j.n, ir) ||
+                !image_store_read(root_, j.day, ir, jpeg) ||
+                !thumb_make(jpeg, thumbs, tr) ||
+                !store_->put(j.day, j.n, thumbs, tr)) {
+                metric_inc(C_THUMBS_FAILED);
+                continue;
+            }
+            metric_inc(C_THUMBS_MADE);
+            metric_observe_ns(H_THUMB_MAKE, metrics_now_ns() - t0);
+        }
+    }
+
+    std::string                 root_;
+    std::unique_ptr<ThumbStore> store_;
+    size_t                      threads_ = 0;
+    std::mutex                  mu_;
+    std::condition_variable     cv_;
+    std::deque<Job>             queue_;
+};
@@ -0,0 +1,334 @@
+#pragma once
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "metrics.h"
+#include "image_store.h"
+
+/* io_uring is opt-in: build with -DIMAGE_WRITER_URING -luring */
+#if defined(IMAGE_WRITER_URING) && __has_include(<liburing.h>)
+#include <liburing.h>
+#define IMAGE_WRITER_HAS_URING 1
+#endif
+
+/*
+   Completed image frames are written to disk off the receive path.
+
+   Each receiver worker hands its finished slabs to the single writer
+   thread over its own SPSC queue and gets them back, once written, over
+   a second one. The queues are as deep as the worker's slab pool, so a
+   push can never fail and the worker never waits on the filesystem.
+
+   The writer takes up to IMAGE_WRITE_BATCH frames at a time, appends
+   them to the image store (image_store.h) together (one io_uring
+   submission, or pwritev per frame without it), indexes them with a
+   single write and then publishes them. Durability is a group commit
+   like the event journal: the store is fsync()ed once sync_every frames
+   have accumulated or sync_ms have passed since the oldest, whichever
+   comes first. 0/0 leaves writeback to the kernel.
+*/
+
+#define IMAGE_WRITE_BATCH   16
+
+/* ================= SPSC QUEUE ================= */
+template <typename T>
+class SpscQueue {
+public:
+    void init(size_t min_capacity)
+    {
+        size_t n = 2;
+        while (n < min_capacity) n <<= 1;
+        buf_.assign(n, T{});
+        mask_ = n - 1;
+    }
+
+    bool push(const T& v)
+    {
+        uint64_t t = tail_.load(std::memory_order_relaxed);
+        if (t - head_.load(std::memory_order_acquire) > mask_) return false;
+        buf_[t & mask_] = v;
+        tail_.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& v)
+    {
+        uint64_t h = head_.load(std::memory_order_relaxed);
+        if (h == tail_.load(std::memory_order_acquire)) return false;
+        v = buf_[h & mask_];
+        head_.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> buf_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<uint64_t> head_{0};     // consumer
+    alignas(64) std::atomic<uint64_t> tail_{0};     // producer
+};
+
+/* ================= WRITER ================= */
+struct ImageJob {
+    uint8_t* data;          // slab, owned by the writer until returned
+    uint32_t len;
+    uint32_t device;        // camera IPv4 address, host order
+    uint32_t event_id;      // from the chunk headers, 0 = none
+    uint16_t frame_id;
+    uint16_t worker;
+    uint64_t done_ns;       // frame completed (metrics clock)
+};
+
+struct ImageWriterOptions {
+    std::string dir        = IMAGE_STORE_DIR;
+    uint32_t    sync_every = 16;
+    uint32_t    sync_ms    = 500;
+};
+
+class ImageWriter {
+public:
+    /* publish(job, day, n) runs on the writer thread once image <day>/<n>.jpg is stored */
+    using PublishFn = std::function<void(const ImageJob&, const std::string&, uint32_t)>;
+
+    bool start(size_t workers, size_t slabs_per_worker,
+               const ImageWriterOptions& opt, PublishFn publish)
+    {
+        opt_ = opt;
+        if (!store_.open(opt_.dir)) return false;
+
+        publish_ = std::move(publish);
+        jobs_ = std::vector<SpscQueue<ImageJob>>(workers);
+        done_ = std::vector<SpscQueue<uint8_t*>>(workers);
+        for (size_t i = 0; i < workers; i++) {
+            jobs_[i].init(slabs_per_worker + 1);
+            done_[i].init(slabs_per_worker + 1);
+        }
+        wake_ = eventfd(0, EFD_CLOEXEC);
+
+#ifdef IMAGE_WRITER_HAS_URING
+        uring_ = io_uring_queue_init(IMAGE_WRITE_BATCH * 2, &ring_, 0) == 0;
+#endif
+        std::thread(&ImageWriter::run, this).detach();
+        return true;
+    }
+
+    const char* backend() const { return uring_ ? "io_uring" : "pwritev"; }
+
+    /* worker side: queue a completed frame, never blocks */
+    void submit(const ImageJob& j)
+    {
+        jobs_[j.worker].push(j);
+        metric_gauge_add(G_IMAGE_WRITE_QUEUE, 1);
+
+        uint64_t one = 1;
+        if (write(wake_, &one, sizeof(one)) < 0) { /* counter saturated: writer is awake */ }
+    }
+
+    /* worker side: collect slabs whose frames are on disk */
+    template <typename F>
+    void reclaim(size_t worker, F&& put)
+    {
+        uint8_t* p;
+        while (done_[worker].pop(p)) put(p);
+    }
+
+private:
+    struct Pending {
+        ImageJob          job;
+        ImageStore::Slot  slot;
+        bool              ok;
+    };
+
+    void run()
+    {
+        std::vector<Pending> batch;
+        batch.reserve(IMAGE_WRITE_BATCH);
+        size_t next = 0;
+
+        for (;;) {
+            // round-robin over the workers so none can starve the others
+            batch.clear();
+            for (size_t idle = 0; idle < jobs_.size() && batch.size() < IMAGE_WRITE_BATCH; ) {
+                ImageJob j;
+                if (jobs_[next].pop(j)) {
+                    batch.push_back(Pending{j, {-1, 0, 0}, false});
+                    idle = 0;
+                } else {
+                    idle++;
+                }
+                next = (next + 1) % jobs_.size();
+            }
+
+            if (batch.empty()) {
+                wait();
+            } else {
+                metric_gauge_add(G_IMAGE_WRITE_QUEUE, -(int64_t)batch.size());
+                write_batch(batch);
+            }
+            maybe_sync();
+        }
+    }
+
+    /* sleep until a frame is queued or the group-commit timer fires */
+    void wait()
+    {
+        int timeout = -1;
+        if (unsynced_frames_ && opt_.sync_ms) {
+            uint64_t age = (metrics_now_ns() - first_unsynced_ns_) / 1000000;
+            timeout = age >= opt_.sync_ms ? 0 : (int)(opt_.sync_ms - age);
+        }
+        pollfd p = {wake_, POLLIN, 0};
+        if (poll(&p, 1, timeout) > 0) {
+            uint64_t n;
+            if (read(wake_, &n, sizeof(n)) < 0) { /* spurious wakeup */ }
+        }
+    }
+
+    void write_batch(std::vector<Pending>& batch)
+    {
+        uint64_t w0 = metrics_now_ns();
+        uint32_t now = (uint32_t)time(nullptr);
+
+        // one capture time per batch, so a batch never straddles two days
+        bool open = store_.begin(now);
+        for (Pending& p : batch)
+            p.ok = open && store_.reserve(p.job.len, p.slot);
+
+        std::vector<uint32_t> written(batch.size(), 0);
+#ifdef IMAGE_WRITER_HAS_URING
+        if (uring_) {
+            unsigned n = 0;
+            for (size_t i = 0; i < batch.size(); i++) {
+                if (!batch[i].ok) continue;
+                io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+                io_uring_prep_write(sqe, batch[i].slot.fd, batch[i].job.data, batch[i].job.len,
+                                    batch[i].slot.offset);
+                io_uring_sqe_set_data(sqe, (void*)(uintptr_t)i);
+                n++;
+            }
+            io_uring_submit_and_wait(&ring_, n);
+            for (unsigned c = 0; c < n; c++) {
+                io_uring_cqe* cqe;
+                if (io_uring_wait_cqe(&ring_, &cqe) < 0) break;
+                size_t i = (uintptr_t)io_uring_cqe_get_data(cqe);
+                if (cqe->res > 0) written[i] = (uint32_t)cqe->res;
+                io_uring_cqe_seen(&ring_, cqe);
+            }
+        }
+#endif
+        // pwritev path, and whatever a short io_uring write left over
+        std::vector<ImageRecord> recs;
+        for (size_t i = 0; i < batch.size(); i++) {
+            Pending& p = batch[i];
+            if (p.ok && !write_all(p.slot, p.job.data, p.job.len, written[i])) {
+                perror("[IMAGE] write");
+                p.ok = false;
+            }
+            if (!p.ok) {
+                metric_inc(C_IMAGE_WRITE_ERRORS);
+                continue;
+            }
+
+            ImageRecord r{};
+            r.crc32    = journal_crc32(p.job.data, p.job.len);
+            r.time     = now;
+            r.device   = p.job.device;
+            r.event_id = p.job.event_id;
+            r.frame_id = p.job.frame_id;
+            r.pack     = p.slot.pack;
+            r.len      = p.job.len;
+            r.offset   = p.slot.offset;
+            recs.push_back(r);
+        }
+
+        int64_t first = recs.empty() ? 0 : store_.commit(recs.data(), recs.size());
+        if (first < 0) {
+            perror("[IMAGE] index");
+            metric_inc(C_IMAGE_WRITE_ERRORS, recs.size());
+        }
+
+        uint64_t w1 = metrics_now_ns();
+        int64_t n = first;
+        for (Pending& p : batch) {
+            // the slab is free again as soon as the data is in the page cache
+            done_[p.job.worker].push(p.job.data);
+            if (!p.ok || first < 0) continue;
+
+            metric_observe_ns(H_DISK_WRITE_IMAGE, (w1 - w0) / batch.size());
+            publish_(p.job, store_.day(), (uint32_t)n++);
+            metric_observe_ns(H_IMAGE_WRITE_LAG, metrics_now_ns() - p.job.done_ns);
+
+            if (!unsynced_frames_) first_unsynced_ns_ = w1;
+            unsynced_frames_++;
+        }
+
+        if (!opt_.sync_every && !opt_.sync_ms) {
+            unsynced_frames_ = 0;
+            store_.sync_done();
+        }
+    }
+
+    static bool write_all(const ImageStore::Slot& s, const uint8_t* data, uint32_t len, uint32_t done)
+    {
+        while (done < len) {
+            iovec iov = {(void*)(data + done), len - done};
+            ssize_t n = pwritev(s.fd, &iov, 1, (off_t)(s.offset + done));
+            if (n <= 0) return false;
+            done += (uint32_t)n;
+        }
+        return true;
+    }
+
+    void maybe_sync()
+    {
+        if (!unsynced_frames_) return;
+        bool due = (opt_.sync_every && unsynced_frames_ >= opt_.sync_every) ||
+                   (opt_.sync_ms && (metrics_now_ns() - first_unsynced_ns_) / 1000000 >= opt_.sync_ms);
+        if (!due) return;
+
+        std::vector<int> fds;
+        store_.dirty(fds);
+
+#ifdef IMAGE_WRITER_HAS_URING
+        if (uring_) {
+            for (size_t i = 0; i < fds.size(); ) {
+                unsigned n = 0;
+                for (; i < fds.size() && n < IMAGE_WRITE_BATCH * 2; i++, n++)
+                    io_uring_prep_fsync(io_uring_get_sqe(&ring_), fds[i], 0);
+                io_uring_submit_and_wait(&ring_, n);
+                for (unsigned c = 0; c < n; c++) {
+                    io_uring_cqe* cqe;
+                    if (io_uring_wait_cqe(&ring_, &cqe) < 0) break;
+                    io_uring_cqe_seen(&ring_, cqe);
+                }
+            }
+        } else
+#endif
+        for (int fd : fds) fsync(fd);
+
+        store_.sync_done();
+        unsynced_frames_ = 0;
+    }
+
+    ImageWriterOptions               opt_;
+    PublishFn                        publish_;
+    std::vector<SpscQueue<ImageJob>> jobs_;
+    std::vector<SpscQueue<uint8_t*>> done_;
+    ImageStore                       store_;
+    int                              wake_ = -1;
+    bool                             uring_ = false;
+#ifdef IMAGE_WRITER_HAS_URING
+    io_uring                         ring_;
+#endif
+    size_t                           unsynced_frames_ = 0;
+    uint64_t                         first_unsynced_ns_ = 0;
+};
@@ -0,0 +1,301 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#include "event_record.h"
+
+/*
+   Live state shared by event_server, receiver and dashboard_server
+   through POSIX shared memory (/dev/shm/rvims_live).
+
+   - event ring   : written by event_server only
+   - image ring   : written by receiver only
+   - device table : latest event per STM32 board, event_server only
+
+   Every slot is a seqlock: the single writer bumps the slot sequence
+   to odd, copies the payload, and bumps it back to even. Readers copy
+   and retry if the sequence moved, so writers never wait on readers
+   and a slow dashboard cannot stall ingest.
+*/
+
+#define LIVE_SHM_NAME       "/rvims_live"
+#define LIVE_VERSION        1
+#define LIVE_EVENT_SLOTS    1024
+#define LIVE_IMAGE_SLOTS    256
+#define LIVE_DEVICE_SLOTS   256
+
+template <typename T>
+struct SeqSlot {
+    std::atomic<uint32_t> seq{0};
+    T                     val;
+
+    void store(const T& v)
+    {
+        uint32_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy((void*)&val, &v, sizeof(T));
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    /* false if the slot was never written (or its writer died mid-store) */
+    bool load(T& out) const
+    {
+        for (int spin = 0; spin < 100000; spin++) {
+            uint32_t s1 = seq.load(std::memory_order_acquire);
+            if (s1 == 0) return false;
+            if (s1 & 1) continue;
+
+            memcpy(&out, (const void*)&val, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (seq.load(std::memory_order_relaxed) == s1) return true;
+        }
+        return false;
+    }
+};
+
+struct LiveEvent {
+    uint64_t    id;         // journal sequence
+    EventRecord ev;
+};
+
+struct LiveImage {
+    uint64_t id;            // receiver image sequence
+    uint32_t time;          // UTC seconds when the frame completed
+    uint32_t event_id;      // triggering event (journal ID), 0 = none
+    uint16_t frame_id;
+    uint8_t  has_fix;       // lat/lon come from the triggering event
+    uint8_t  reserved[5];
+    double   lat;
+    double   lon;
+    char     path[112];     // "<day>/<n>.jpg" in the image store
+};
+
+struct LiveDevice {
+    std::atomic<uint32_t> device_id{0};     // 0 = free
+    SeqSlot<LiveEvent>    last;
+};
+
+/*
+   A ring of the most recent N entries. head counts entries ever
+   published; entry k lives in slot k % N while k >= head - N.
+*/
+template <typename T, size_t N>
+struct LiveRing {
+    std::atomic<uint64_t> head{0};
+    SeqSlot<T>            slots[N];
+
+    void publish(const T& v)
+    {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        slots[h % N].store(v);
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    bool latest(T& out) const
+    {
+        uint64_t h = head.load(std::memory_order_acquire);
+        return h && slots[(h - 1) % N].load(out);
+    }
+
+    /* visit entries published at index >= from (oldest retained first) */
+    template <typename F>
+    uint64_t read_since(uint64_t from, F&& fn) const
+    {
+        uint64_t h = head.load(std::memory_order_acquire);
+        if (h > N && from < h - N) from = h - N;
+
+        for (uint64_t k = from; k < h; k++) {
+            T v;
+            if (slots[k % N].load(v)) fn(k, v);
+        }
+        return h;
+    }
+};
+
+struct LiveState {
+    std::atomic<uint32_t> magic;
+    uint32_t              version;
+    uint32_t              size;
+    uint32_t              created;      // UTC seconds; ring heads restart with the segment
+
+    LiveRing<LiveEvent, LIVE_EVENT_SLOTS> events;
+    LiveRing<LiveImage, LIVE_IMAGE_SLOTS> images;
+    LiveDevice                            devices[LIVE_DEVICE_SLOTS];
+
+    /* latest event per board; event_server is the only caller */
+    void publish_event(const LiveEvent& e)
+    {
+        events.publish(e);
+
+        uint32_t key = e.ev.device_id;
+        for (uint32_t i = 0; i < LIVE_DEVICE_SLOTS; i++) {
+            LiveDevice& d = devices[(key + i) % LIVE_DEVICE_SLOTS];
+            uint32_t id = d.device_id.load(std::memory_order_relaxed);
+            if (id != 0 && id != key + 1) continue;
+
+            if (id == 0) d.device_id.store(key + 1, std::memory_order_release);
+            d.last.store(e);
+            return;
+        }
+    }
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "live state needs lock-free 64-bit atomics across processes");
+
+#define LIVE_MAGIC  0x4556494Cu     // "LIVE"
+
+/*
+   Map (creating if needed) the shared segment. Zero-filled memory is a
+   valid empty state, so whichever process comes first just sizes it.
+*/
+inline LiveState* live_state_open()
+{
+    int fd = shm_open(LIVE_SHM_NAME, O_RDWR | O_CREAT, 0666);
+    if (fd < 0) {
+        perror("[LIVE] shm_open");
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size == 0 &&
+        ftruncate(fd, sizeof(LiveState)) != 0) {
+        perror("[LIVE] ftruncate");
+        close(fd);
+        return nullptr;
+    }
+    fstat(fd, &st);
+    if ((size_t)st.st_size != sizeof(LiveState)) {
+        fprintf(stderr, "[LIVE] %s has a different layout, remove /dev/shm%s\n",
+                LIVE_SHM_NAME, LIVE_SHM_NAME);
+        close(fd);
+        return nullptr;
+    }
+
+    void* p = mmap(nullptr, sizeof(LiveState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        perror("[LIVE] mmap");
+        return nullptr;
+    }
+
+    LiveState* ls = (LiveState*)p;
+
+    uint32_t expect = 0;
+    if (ls->magic.compare_exchange_strong(expect, LIVE_MAGIC)) {
+        ls->version = LIVE_VERSION;
+        ls->size    = sizeof(LiveState);
+        ls->created = (uint32_t)time(nullptr);
+    }
+    return ls;
+}
+
+/*
+   Process-private live state for rvims_server: the same rings, shared
+   between threads instead of processes.
+*/
+inline LiveState* live_state_local()
+{
+    void* p = mmap(nullptr, sizeof(LiveState), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        perror("[LIVE] mmap");
+        return nullptr;
+    }
+
+    LiveState* ls = (LiveState*)p;
+    ls->magic.store(LIVE_MAGIC);
+    ls->version = LIVE_VERSION;
+    ls->size    = sizeof(LiveState);
+    ls->created = (uint32_t)time(nullptr);
+    return ls;
+}
+
+/* ================= JSON VIEWS ================= */
+/* same shape as the old data/stm32.json */
+inline std::string event_json(const EventRecord& ev)
+{
+    char lat[32] = "NA", lon[32] = "NA", date[16] = "NA", time[16] = "NA";
+    if (ev.has_fix) {
+        snprintf(lat,  sizeof(lat),  "%.6f", ev.lat);
+        snprintf(lon,  sizeof(lon),  "%.6f", ev.lon);
+        snprintf(date, sizeof(date), "%02d-%02d-%04d", ev.day, ev.month, ev.year);
+        snprintf(time, sizeof(time), "%02d:%02d:%02d", ev.hour, ev.min, ev.sec);
+    }
+
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "{\n"
+             "  \"event\": \"%.8s\",\n"
+             "  \"lat\": \"%s\",\n"
+             "  \"lon\": \"%s\",\n"
+             "  \"date\": \"%s\",\n"
+             "  \"time\": \"%s\"\n"
+             "}\n",
+             ev.event, lat, lon, date, time);
+    return buf;
+}
+
+/* one element of the old data/esp32.json array, plus the event link */
+inline std::string image_json(const LiveImage& im)
+{
+    time_t t = im.time;
+    char ts[64];
+    strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", localtime(&t));
+
+    char lat[32] = "null", lon[32] = "null";
+    if (im.has_fix) {
+        snprintf(lat, sizeof(lat), "%.6f", im.lat);
+        snprintf(lon, sizeof(lon), "%.6f", im.lon);
+    }
+
+    char buf[384];
+    snprintf(buf, sizeof(buf),
+             "  {\n"
+             "    \"image\": \"%s\",\n"
+             "    \"event\": %u,\n"
+             "    \"lat\": %s,\n"
+             "    \"lon\": %s,\n"
+             "    \"time\": \"%s\"\n"
+             "  }",
+             im.path, im.event_id, lat, lon, ts);
+    return buf;
+}
+
+/*
+   Entries published at version since or later, as
+   {"version": V, "complete": bool, "<key>": [...]} where V is the
+   version to ask for next. complete is false if some of them have
+   already left the ring (or since isn't from this ring), so the
+   client should reload in full instead.
+*/
+template <typename T, size_t N, typename F>
+inline std::string live_delta_json(const LiveRing<T, N>& ring, uint64_t since, const char* key, F&& to_json)
+{
+    std::string items;
+    bool complete = true;
+    uint64_t h = ring.head.load(std::memory_order_acquire);
+    if (since > h || (h > N && since < h - N)) {
+        complete = false;
+        since = 0;
+    }
+    h = ring.read_since(since, [&](uint64_t, const T& v) {
+        items += items.empty() ? "\n" : ",\n";
+        items += to_json(v);
+    });
+
+    char head[96];
+    snprintf(head, sizeof(head), "{\n  \"version\": %llu,\n  \"complete\": %s,\n  \"%s\": [",
+             (unsigned long long)h, complete ? "true" : "false", key);
+    return head + items + (items.empty() ? "]\n}\n" : "\n  ]\n}\n");
+}
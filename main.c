@@ -5,6 +5,7 @@
 #include "adxl345.h"
 #include "oled.h"
 #include "gps.h"
+#include "event_proto.h"
 #include <stdio.h>
 #include <string.h>
 #include <usart_debug.h>
@@ -20,6 +21,72 @@ static uint32_t detect_time_ms = 0;
 uint8_t SERVER_IP[4] = {192,168,1,106};   // PC IP
 #define SERVER_PORT 5000
 
+// WIRE FORMAT: 1 = binary v2 frame (event_proto.h), 0 = legacy text line
+#ifndef EVENT_PROTO_V2
+#define EVENT_PROTO_V2 1
+#endif
+
+#if EVENT_PROTO_V2
+static uint32_t event_seq = 0;
+
+// Largest axis reading in milli-g (3.9 mg/LSB)
+static uint16_t read_peak_mg(void)
+{
+    int16_t x, y, z;
+    adxl345_read_raw(&x, &y, &z);
+
+    int32_t peak = x < 0 ? -x : x;
+    if ((y < 0 ? -y : y) > peak) peak = y < 0 ? -y : y;
+    if ((z < 0 ? -z : z) > peak) peak = z < 0 ? -z : z;
+
+    return (uint16_t)(peak * 39 / 10);
+}
+
+// "LAT 28.6141" from degrees * 1e7, without float printf
+static void oled_show_e7(uint8_t row, const char *label, int32_t e7)
+{
+    char buf[24];
+    uint32_t a = e7 < 0 ? (uint32_t)-e7 : (uint32_t)e7;
+
+    snprintf(buf, sizeof(buf), "%s %s%lu.%04lu", label, e7 < 0 ? "-" : "",
+             (unsigned long)(a / 10000000u), (unsigned long)(a % 10000000u / 1000u));
+    oled_set_cursor(row, 0);
+    oled_write_string(buf);
+}
+
+static void send_event_v2(void)
+{
+    event_frame_v2_t f;
+    memset(&f, 0, sizeof(f));
+
+    // 96-bit factory UID folded to 32 bits
+    const uint32_t *uid = (const uint32_t *)UID_BASE;
+    f.device_id = uid[0] ^ uid[1] ^ uid[2];
+    f.seq       = ++event_seq;
+    f.type      = EVENT_V2_TYPE_2G;
+    f.peak_mg   = read_peak_mg();
+
+    if (gps_fix_available())
+    {
+        f.flags  = EVENT_V2_FLAG_FIX;
+        f.lat_e7 = gps_get_lat_e7();
+        f.lon_e7 = gps_get_lon_e7();
+        f.epoch  = gps_get_epoch();
+
+        oled_show_e7(2, "LAT", f.lat_e7);
+        oled_show_e7(3, "LON", f.lon_e7);
+    }
+    else
+    {
+        oled_set_cursor(4,20);
+        oled_write_string("NO GPS FIX");
+    }
+
+    event_v2_seal(&f);
+    w5500_tcp_send((const uint8_t *)&f, sizeof(f));
+}
+#endif
+
 void SysTick_Handler(void)
 {
     ms_ticks++;
@@ -38,8 +105,10 @@ void EXTI0_IRQHandler(void)
 
 int main(void)
 {
+#if !EVENT_PROTO_V2
     char tcp_msg[128];
     char buf[64];
+#endif
 
   
     USART2_Init();
@@ -97,6 +166,9 @@ int main(void)
 
                     usart_debug("2G DETECTED\r\n");
 
+#if EVENT_PROTO_V2
+                    send_event_v2();
+#else
                     if (gps_fix_available())
                     {
                         snprintf(tcp_msg, sizeof(tcp_msg),
@@ -129,6 +201,7 @@ int main(void)
 
                     // SEND TO SERVER
                     w5500_tcp_send((uint8_t*)tcp_msg, strlen(tcp_msg));
+#endif
                     usart_debug("TCP MSG SENT\r\n");
 
                     detect_time_ms = ms_ticks;
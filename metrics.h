@@ -0,0 +1,423 @@
+#pragma once
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+/*
+   Pipeline metrics shared by event_server, receiver and dashboard_server
+   through POSIX shared memory (/dev/shm/rvims_metrics).
+
+   Each writing thread claims its own shard on first use and hands it
+   back when it exits, so counter and histogram updates are plain
+   relaxed loads/stores with no locked instructions and no sharing
+   between cores. Gauges go up in one thread and down in another, so
+   they live in one shard per process, updated atomically. A shard whose
+   owning process has died is reused by the next claimer; its counters
+   and histograms keep their totals and its gauges are no longer
+   exported. dashboard_server sums all shards and renders them at
+   /metrics in Prometheus text format.
+
+   Histograms are HDR-style log-linear: values (nanoseconds) below 8 get
+   a bucket each, above that every power of two is split into 8
+   sub-buckets, giving ~12% relative error over the whole 64-bit range.
+*/
+
+#define METRICS_SHM_NAME    "/rvims_metrics"
+#define METRICS_MAGIC       0x5254454Du     // "METR"
+#define METRICS_VERSION     1
+#define METRICS_SHARDS      64
+#define HIST_SUB_BITS       3
+#define HIST_BUCKETS        512
+
+/* ---------- metric table: add new metrics at the end of their group ---------- */
+enum CounterId {
+    C_EVENTS_TEXT,
+    C_EVENTS_V2,
+    C_EVENTS_BAD,
+    C_CAPTURES_SENT,
+    C_CONNS_ACCEPTED,
+    C_CONNS_CLOSED,
+    C_CHUNKS_RX,
+    C_CHUNKS_DUP,
+    C_CHUNKS_LOST,
+    C_FRAMES_DONE,
+    C_FRAMES_DROPPED,
+    C_HTTP_REQUESTS,
+    C_UDP_KERNEL_DROPS,
+    C_CHUNKS_BAD,
+    C_FRAMES_EXPIRED,
+    C_FRAMES_EVICTED,
+    C_NACKS_SENT,
+    C_CHUNKS_PARITY,
+    C_CHUNKS_FEC_RECOVERED,
+    C_IMAGE_WRITE_ERRORS,
+    C_THUMBS_MADE,
+    C_THUMBS_FAILED,
+    C_THUMBS_SKIPPED,
+    C_COUNT
+};
+
+enum GaugeId {
+    G_CONNS_OPEN,
+    G_FRAMES_PENDING,
+    G_FRAME_MEMORY,
+    G_IMAGE_WRITE_QUEUE,
+    G_THUMB_QUEUE,
+    G_SSE_CLIENTS,
+    G_COUNT
+};
+
+enum HistId {
+    H_EVENT_PARSE,
+    H_CAPTURE_TRIGGER,
+    H_FRAME_REASSEMBLY,
+    H_DISK_WRITE_JOURNAL,
+    H_DISK_WRITE_IMAGE,
+    H_HTTP_HANDLER,
+    H_IMAGE_WRITE_LAG,
+    H_THUMB_MAKE,
+    H_COUNT
+};
+
+struct MetricDesc {
+    const char* name;       // metrics sharing a name must be adjacent
+    const char* labels;     // "" or `key="value"`
+    const char* help;
+};
+
+static const MetricDesc COUNTER_DESC[C_COUNT] = {
+    {"rvims_events_total",          "proto=\"text\"", "STM32 events ingested"},
+    {"rvims_events_total",          "proto=\"v2\"",   "STM32 events ingested"},
+    {"rvims_event_bad_frames_total", "",              "Frames or lines that failed to decode"},
+    {"rvims_captures_sent_total",   "",               "CAPTURE commands sent to the ESP32"},
+    {"rvims_connections_accepted_total", "",          "STM32 connections accepted"},
+    {"rvims_connections_closed_total",   "",          "STM32 connections closed"},
+    {"rvims_image_chunks_total",    "",               "Image chunks received"},
+    {"rvims_image_chunks_duplicate_total", "",        "Duplicate image chunks ignored"},
+    {"rvims_image_chunks_lost_total", "",             "Image chunks missing from abandoned frames"},
+    {"rvims_image_frames_total",    "result=\"complete\"", "Image frames by outcome"},
+    {"rvims_image_frames_total",    "result=\"dropped\"",  "Image frames by outcome"},
+    {"rvims_http_requests_total",   "",               "Dashboard HTTP requests"},
+    {"rvims_udp_kernel_drops_total", "",              "Image datagrams dropped by the kernel (receive buffer full)"},
+    {"rvims_image_chunks_bad_total", "",              "Image chunks with an impossible header"},
+    {"rvims_image_frames_evicted_total", "reason=\"timeout\"", "Incomplete image frames discarded"},
+    {"rvims_image_frames_evicted_total", "reason=\"memory\"",  "Incomplete image frames discarded"},
+    {"rvims_image_nacks_sent_total", "",              "Missing-chunk NACKs sent to cameras"},
+    {"rvims_image_parity_chunks_total", "",           "Reed-Solomon repair chunks received"},
+    {"rvims_image_chunks_fec_recovered_total", "",    "Lost image chunks rebuilt from repair chunks"},
+    {"rvims_image_write_errors_total", "",            "Completed image frames that could not be written"},
+    {"rvims_image_thumbnails_total", "result=\"made\"",    "Stored images by thumbnail outcome"},
+    {"rvims_image_thumbnails_total", "result=\"failed\"",  "Stored images by thumbnail outcome"},
+    {"rvims_image_thumbnails_total", "result=\"skipped\"", "Stored images by thumbnail outcome"},
+};
+
+static const MetricDesc GAUGE_DESC[G_COUNT] = {
+    {"rvims_connections_open",      "", "STM32 connections currently open"},
+    {"rvims_image_frames_pending",  "", "Image frames being reassembled"},
+    {"rvims_image_frame_memory_bytes", "", "Reassembly slab memory held by the receiver"},
+    {"rvims_image_write_queue",     "", "Completed image frames waiting for the disk writer"},
+    {"rvims_image_thumb_queue",     "", "Stored images waiting for their thumbnails"},
+    {"rvims_dashboard_stream_clients", "", "Browsers subscribed to /api/stream"},
+};
+
+static const MetricDesc HIST_DESC[H_COUNT] = {
+    {"rvims_event_parse_seconds",       "", "Time to decode one event"},
+    {"rvims_capture_trigger_seconds",   "", "Event bytes received to CAPTURE sent"},
+    {"rvims_frame_reassembly_seconds",  "", "First to last chunk of an image frame"},
+    {"rvims_disk_write_seconds",        "target=\"journal\"", "Time spent writing to disk"},
+    {"rvims_disk_write_seconds",        "target=\"image\"",   "Time spent writing to disk"},
+    {"rvims_http_handler_seconds",      "", "Dashboard request handling time"},
+    {"rvims_image_write_lag_seconds",   "", "Image frame complete to written and published"},
+    {"rvims_image_thumbnail_seconds",   "", "Time to make the thumbnails of one image"},
+};
+
+/* ---------- shared layout ---------- */
+struct HistShard {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> buckets[HIST_BUCKETS];
+};
+
+struct MetricsShard {
+    std::atomic<int32_t>  owner;            // pid, 0 = free
+    std::atomic<uint64_t> counters[C_COUNT];
+    std::atomic<int64_t>  gauges[G_COUNT];
+    HistShard             hists[H_COUNT];
+};
+
+struct MetricsShm {
+    std::atomic<uint32_t> magic;
+    uint32_t              version;
+    uint32_t              size;
+    MetricsShard          shards[METRICS_SHARDS];
+};
+
+inline uint32_t hist_bucket(uint64_t v)
+{
+    if (v < (1u << HIST_SUB_BITS)) return (uint32_t)v;
+
+    uint32_t e = 63 - __builtin_clzll(v);
+    return (e - HIST_SUB_BITS + 1) * (1u << HIST_SUB_BITS) +
+           (uint32_t)((v >> (e - HIST_SUB_BITS)) & ((1u << HIST_SUB_BITS) - 1));
+}
+
+/* largest value that lands in bucket b */
+inline uint64_t hist_bucket_upper(uint32_t b)
+{
+    const uint32_t sub = 1u << HIST_SUB_BITS;
+    if (b < sub) return b;
+
+    uint32_t e = b / sub + HIST_SUB_BITS - 1;
+    uint64_t base = (uint64_t)(sub + b % sub) << (e - HIST_SUB_BITS);
+    return base + ((1ull << (e - HIST_SUB_BITS)) - 1);
+}
+
+inline uint64_t metrics_now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* ================= WRITER SIDE ================= */
+namespace metrics_detail {
+
+inline MetricsShm*& shm()
+{
+    static MetricsShm* p = nullptr;
+    return p;
+}
+
+/* the process's gauge shard, claimed by metrics_open() */
+inline MetricsShard*& home()
+{
+    static MetricsShard* p = nullptr;
+    return p;
+}
+
+/* gives the thread's shard back when the thread exits */
+struct ShardGuard {
+    MetricsShard* s = nullptr;
+    ~ShardGuard()
+    {
+        if (s) s->owner.store(0, std::memory_order_release);
+        s = nullptr;
+    }
+};
+
+inline MetricsShard*& local()
+{
+    static thread_local ShardGuard g;
+    return g.s;
+}
+
+inline bool owner_alive(int32_t pid)
+{
+    return pid != 0 && !(kill(pid, 0) < 0 && errno == ESRCH);
+}
+
+/* single writer per shard: no read-modify-write needed */
+template <typename A, typename V>
+inline void bump(A& a, V d)
+{
+    a.store(a.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+}
+
+inline MetricsShard* claim()
+{
+    MetricsShm* m = shm();
+    if (!m) return nullptr;
+
+    int32_t me = (int32_t)getpid();
+    for (int i = 0; i < METRICS_SHARDS; i++) {
+        MetricsShard& s = m->shards[i];
+        int32_t owner = s.owner.load(std::memory_order_relaxed);
+
+        /* free, or left behind by a process that has exited */
+        if (owner == me || owner_alive(owner)) continue;
+        if (!s.owner.compare_exchange_strong(owner, me)) continue;
+
+        /* counters and histograms keep their totals; gauges are per owner */
+        for (auto& g : s.gauges) g.store(0, std::memory_order_relaxed);
+        return &s;
+    }
+
+    static std::atomic<bool> warned{false};
+    if (!warned.exchange(true))
+        fprintf(stderr, "[METRICS] all %d shards in use, some updates are dropped\n",
+                METRICS_SHARDS);
+    return nullptr;
+}
+
+inline MetricsShard* shard()
+{
+    MetricsShard*& s = local();
+    if (!s) s = claim();
+    return s;
+}
+
+} // namespace metrics_detail
+
+/* map (creating if needed) the shared metrics segment */
+inline MetricsShm* metrics_open()
+{
+    MetricsShm*& m = metrics_detail::shm();
+    if (m) return m;
+
+    int fd = shm_open(METRICS_SHM_NAME, O_RDWR | O_CREAT, 0666);
+    if (fd < 0) {
+        perror("[METRICS] shm_open");
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size == 0 &&
+        ftruncate(fd, sizeof(MetricsShm)) != 0) {
+        perror("[METRICS] ftruncate");
+        close(fd);
+        return nullptr;
+    }
+    fstat(fd, &st);
+    if ((size_t)st.st_size != sizeof(MetricsShm)) {
+        fprintf(stderr, "[METRICS] %s has a different layout, remove /dev/shm%s\n",
+                METRICS_SHM_NAME, METRICS_SHM_NAME);
+        close(fd);
+        return nullptr;
+    }
+
+    void* p = mmap(nullptr, sizeof(MetricsShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        perror("[METRICS] mmap");
+        return nullptr;
+    }
+
+    m = (MetricsShm*)p;
+    uint32_t expect = 0;
+    if (m->magic.compare_exchange_strong(expect, METRICS_MAGIC)) {
+        m->version = METRICS_VERSION;
+        m->size    = sizeof(MetricsShm);
+    }
+    metrics_detail::home() = metrics_detail::claim();
+    return m;
+}
+
+/* All updates are no-ops until metrics_open() has succeeded. */
+inline void metric_inc(CounterId id, uint64_t n = 1)
+{
+    if (MetricsShard* s = metrics_detail::shard()) metrics_detail::bump(s->counters[id], n);
+}
+
+inline void metric_gauge_add(GaugeId id, int64_t d)
+{
+    if (MetricsShard* s = metrics_detail::home()) s->gauges[id].fetch_add(d, std::memory_order_relaxed);
+}
+
+inline void metric_observe_ns(HistId id, uint64_t ns)
+{
+    MetricsShard* s = metrics_detail::shard();
+    if (!s) return;
+
+    HistShard& h = s->hists[id];
+    metrics_detail::bump(h.count, 1);
+    metrics_detail::bump(h.sum, ns);
+    metrics_detail::bump(h.buckets[hist_bucket(ns)], 1);
+}
+
+/* observes the lifetime of the scope */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(HistId id) : id_(id), t0_(metrics_now_ns()) {}
+    ~ScopedTimer() { metric_observe_ns(id_, metrics_now_ns() - t0_); }
+
+private:
+    HistId   id_;
+    uint64_t t0_;
+};
+
+/* ================= PROMETHEUS EXPORT ================= */
+inline std::string metrics_prometheus(const MetricsShm* m)
+{
+    std::string out;
+    char line[256];
+
+    auto header = [&](const MetricDesc* d, int i, const char* type) {
+        if (i > 0 && !strcmp(d[i - 1].name, d[i].name)) return;
+        snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n",
+                 d[i].name, d[i].help, d[i].name, type);
+        out += line;
+    };
+    auto labels = [](const MetricDesc& d, const char* extra) {
+        std::string l = d.labels;
+        if (*extra) l += (l.empty() ? "" : ",") + std::string(extra);
+        return l.empty() ? l : "{" + l + "}";
+    };
+
+    for (int i = 0; i < C_COUNT; i++) {
+        uint64_t v = 0;
+        for (auto& s : m->shards) v += s.counters[i].load(std::memory_order_relaxed);
+
+        header(COUNTER_DESC, i, "counter");
+        snprintf(line, sizeof(line), "%s%s %llu\n", COUNTER_DESC[i].name,
+                 labels(COUNTER_DESC[i], "").c_str(), (unsigned long long)v);
+        out += line;
+    }
+
+    for (int i = 0; i < G_COUNT; i++) {
+        int64_t v = 0;
+        for (auto& s : m->shards)
+            if (metrics_detail::owner_alive(s.owner.load(std::memory_order_relaxed)))
+                v += s.gauges[i].load(std::memory_order_relaxed);
+
+        header(GAUGE_DESC, i, "gauge");
+        snprintf(line, sizeof(line), "%s%s %lld\n", GAUGE_DESC[i].name,
+                 labels(GAUGE_DESC[i], "").c_str(), (long long)v);
+        out += line;
+    }
+
+    /* exported at power-of-two boundaries from 1us to ~17s */
+    for (int i = 0; i < H_COUNT; i++) {
+        uint64_t b[HIST_BUCKETS] = {};
+        uint64_t count = 0, sum = 0;
+
+        for (auto& s : m->shards) {
+            const HistShard& h = s.hists[i];
+            count += h.count.load(std::memory_order_relaxed);
+            sum   += h.sum.load(std::memory_order_relaxed);
+            for (int k = 0; k < HIST_BUCKETS; k++)
+                b[k] += h.buckets[k].load(std::memory_order_relaxed);
+        }
+
+        header(HIST_DESC, i, "histogram");
+
+        uint64_t cum = 0;
+        uint32_t k = 0;
+        for (int e = 10; e <= 34; e++) {
+            uint64_t le = 1ull << e;
+            while (k < HIST_BUCKETS && hist_bucket_upper(k) < le) cum += b[k++];
+
+            char le_s[32];
+            snprintf(le_s, sizeof(le_s), "le=\"%.9g\"", le / 1e9);
+            snprintf(line, sizeof(line), "%s_bucket%s %llu\n", HIST_DESC[i].name,
+                     labels(HIST_DESC[i], le_s).c_str(), (unsigned long long)cum);
+            out += line;
+        }
+        snprintf(line, sizeof(line), "%s_bucket%s %llu\n", HIST_DESC[i].name,
+                 labels(HIST_DESC[i], "le=\"+Inf\"").c_str(), (unsigned long long)count);
+        out += line;
+        snprintf(line, sizeof(line), "%s_sum%s %.9f\n%s_count%s %llu\n",
+                 HIST_DESC[i].name, labels(HIST_DESC[i], "").c_str(), sum / 1e9,
+                 HIST_DESC[i].name, labels(HIST_DESC[i], "").c_str(), (unsigned long long)count);
+        out += line;
+    }
+    return out;
+}
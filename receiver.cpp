@@ -1,113 +1,45 @@
-#include <arpa/inet.h>
-#include <unistd.h>
-#include <vector>
-#include <fstream>
-#include <ctime>
-#include <iostream>
-#include <map>
-#include <sys/stat.h>
-#include <sys/types.h>
 #include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
 
-#define IMAGE_PORT 9200
-
-#pragma pack(push,1)
-struct jpeg_hdr_t {
-    uint16_t frame_id;
-    uint16_t chunk_id;
-    uint16_t total_chunks;
-    uint16_t payload_size;
-};
-#pragma pack(pop)
-
-struct FrameBuffer {
-    uint16_t total = 0;
-    uint16_t received = 0;
-    std::vector<std::vector<uint8_t>> chunks;
-};
+#include "image_receiver.h"
 
-int main()
+int main(int argc, char* argv[])
 {
-    int sock = socket(AF_INET, SOCK_DGRAM, 0);
-
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(IMAGE_PORT);
-    addr.sin_addr.s_addr = INADDR_ANY;
-
-    bind(sock, (sockaddr*)&addr, sizeof(addr));
-    std::cout << "[IMAGE] Receiver ready on port 9200\n";
-
-    // ensure data folder exists
-    mkdir("data", 0777);
-
-    std::map<uint16_t, FrameBuffer> frames;
-
-    while (1) {
-        uint8_t buf[1500];
-        int len = recv(sock, buf, sizeof(buf), 0);
-        if (len <= 0) continue;
-
-        auto *hdr = (jpeg_hdr_t*)buf;
-        uint16_t frame_id = hdr->frame_id;
-
-        // safety: payload size check
-        if (hdr->payload_size > len - sizeof(jpeg_hdr_t))
-            continue;
-
-        auto &f = frames[frame_id];
-
-        if (f.chunks.empty()) {
-            f.total = hdr->total_chunks;
-            f.received = 0;
-            f.chunks.resize(hdr->total_chunks);
-        }
-
-        // duplicate UDP packet protection
-        if (hdr->chunk_id < f.total && f.chunks[hdr->chunk_id].empty()) {
-            f.chunks[hdr->chunk_id].assign(
-                buf + sizeof(jpeg_hdr_t),
-                buf + sizeof(jpeg_hdr_t) + hdr->payload_size
-            );
-            f.received++;
+    ReceiverOptions o;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--json-files")) o.json_files = true;
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc)
+            o.port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            o.workers = std::max(1, std::min(atoi(argv[++i]), MAX_WORKERS));
+        else if (!strcmp(argv[i], "--frame-budget-mb") && i + 1 < argc)
+            o.budget_mb = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--image-sync") && i + 1 < argc)
+            o.writer.sync_every = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--image-sync-ms") && i + 1 < argc)
+            o.writer.sync_ms = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--thumb-workers") && i + 1 < argc)
+            o.thumb_workers = std::max(0, atoi(argv[++i]));
+        else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--port N] [--threads N] [--frame-budget-mb MB]"
+                         " [--image-sync IMAGES] [--image-sync-ms MS]"
+                         " [--thumb-workers N] [--json-files]\n";
+            return 1;
         }
+    }
 
-        if (f.received == f.total) {
-
-            // create image folder 
-            std::string folder = "image_" + std::to_string(frame_id);
-            mkdir(folder.c_str(), 0777);
-
-            // save image 
-            std::string image_path =
-                folder + "/image_" + std::to_string(frame_id) + ".jpg";
-
-            std::ofstream img(image_path, std::ios::binary);
-            for (auto &c : f.chunks)
-                img.write((char*)c.data(), c.size());
-            img.close();
-
-            //  update esp32.json 
-            std::ofstream js("data/esp32.json");
-
-            time_t now = time(nullptr);
-            char ts[64];
-            strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", localtime(&now));
-
-            js << "[\n";
-            js << "  {\n";
-            js << "    \"image\": \"" << image_path << "\",\n";
-            js << "    \"lat\": 28.6141,\n";
-            js << "    \"lon\": 77.2092,\n";
-            js << "    \"time\": \"" << ts << "\"\n";
-            js << "  }\n";
-            js << "]\n";
-            js.close();
+    LiveState* live = live_state_open();
+    if (!live) return 1;
+    metrics_open();
 
-            frames.erase(frame_id);
+    static ImageReceiver rx;
+    if (!receiver_open(rx, o, live)) return 1;
 
-            std::cout << "[IMAGE] Saved & JSON updated: "
-                      << image_path << std::endl;
-        }
-    }
+    receiver_start(rx);
+    for (auto &t : rx.threads)
+        t.join();
 }
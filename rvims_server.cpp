@@ -0,0 +1,106 @@
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "event_ingest.h"
+#include "image_receiver.h"
+#include "dashboard_routes.h"
+
+/*
+   All of RVIMS in one process: the STM32 ingest loop, one image
+   receiver loop per worker socket and the dashboard, over a single
+   in-process LiveState. Events and images reach /api/stm32,
+   /api/esp32 and /api/stream without going through /dev/shm or the
+   data/ JSON files. event_server, receiver and dashboard_server
+   remain for running the parts on separate hosts.
+*/
+
+static void usage(const char* prog)
+{
+    std::cerr << "usage: " << prog << " [options]\n"
+                 "  --port N                STM32 TCP port (" << TCP_PORT << ")\n"
+                 "  --esp32 IP              camera to send CAPTURE to (" ESP32_IP ")\n"
+                 "  --idle-timeout SEC      close silent boards\n"
+                 "  --journal-sync EVENTS   --journal-sync-ms MS\n"
+                 "  --verbose               log every STM32 event received\n"
+                 "  --image-port N          camera UDP port (" << IMAGE_PORT << ")\n"
+                 "  --threads N             image receiver workers\n"
+                 "  --frame-budget-mb MB    reassembly memory\n"
+                 "  --image-sync IMAGES     --image-sync-ms MS\n"
+                 "  --thumb-workers N\n"
+                 "  --http-port N           dashboard (" << DASH_PORT << ")\n"
+                 "  --http-threads N        --http-streams N\n"
+                 "  --http-keep-alive-max REQUESTS  --http-keep-alive-timeout SEC\n"
+                 "  --http-read-timeout SEC --http-payload-max BYTES\n"
+                 "  --http-web-dir DIR      serve the pages from DIR, not the compiled-in ones\n"
+                 "  --shm                   also publish live state to /dev/shm" LIVE_SHM_NAME "\n"
+                 "                          (for camera_sim and bench_ingest)\n";
+}
+
+int main(int argc, char* argv[])
+{
+    IngestOptions    io;
+    ReceiverOptions  ro;
+    DashboardOptions dopt;
+    bool             shm = false;
+
+    auto arg = [&](int& i, const char* name) {
+        return !strcmp(argv[i], name) && i + 1 < argc;
+    };
+    for (int i = 1; i < argc; i++) {
+        if (arg(i, "--port"))                   io.port = atoi(argv[++i]);
+        else if (arg(i, "--esp32"))             io.esp_ip = argv[++i];
+        else if (arg(i, "--idle-timeout"))      io.idle_timeout_ms = (uint32_t)atoi(argv[++i]) * 1000;
+        else if (arg(i, "--journal-sync"))      io.journal.sync_every = (uint32_t)atoi(argv[++i]);
+        else if (arg(i, "--journal-sync-ms"))   io.journal.sync_ms = (uint32_t)atoi(argv[++i]);
+        else if (arg(i, "--image-port"))        ro.port = atoi(argv[++i]);
+        else if (arg(i, "--threads"))           ro.workers = std::max(1, std::min(atoi(argv[++i]), MAX_WORKERS));
+        else if (arg(i, "--frame-budget-mb"))   ro.budget_mb = std::max(1, atoi(argv[++i]));
+        else if (arg(i, "--image-sync"))        ro.writer.sync_every = (uint32_t)atoi(argv[++i]);
+        else if (arg(i, "--image-sync-ms"))     ro.writer.sync_ms = (uint32_t)atoi(argv[++i]);
+        else if (arg(i, "--thumb-workers"))     ro.thumb_workers = std::max(0, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--shm"))     shm = true;
+        else if (!strcmp(argv[i], "--verbose")) io.verbose = true;
+        else if (!dashboard_option(dopt, argc, argv, i, "--http-")) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    LiveState* live = shm ? live_state_open() : live_state_local();
+    if (!live) return 1;
+    MetricsShm* metrics = metrics_open();
+
+    /* ---------- STM32 INGEST ---------- */
+    static IngestServer ingest;
+    if (!ingest_open(ingest, io, live)) return 1;
+    std::thread([] {
+        ingest_run(ingest);
+        exit(1);            // epoll failed: don't carry on without ingest
+    }).detach();
+
+    /* ---------- IMAGE RECEIVER ---------- */
+    static ImageReceiver rx;
+    if (!receiver_open(rx, ro, live)) return 1;
+    receiver_start(rx);
+
+    /* ---------- DASHBOARD ---------- */
+    httplib::Server svr;
+    dashboard_configure(svr, dopt);
+    dashboard_mount(svr, live, metrics, dopt);
+
+    std::cout << "====================================\n";
+    std::cout << " RVIMS SERVER RUNNING\n";
+    std::cout << " STM32 tcp/" << io.port << ", images udp/" << ro.port
+              << ", dashboard http://localhost:" << dopt.port << '\n';
+    std::cout << "====================================\n";
+
+    if (!svr.listen("0.0.0.0", dopt.port)) {
+        std::cerr << "[DASH] cannot listen on port " << dopt.port << '\n';
+        return 1;
+    }
+}